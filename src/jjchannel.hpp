@@ -0,0 +1,205 @@
+#pragma once
+#include "jjring.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+/**
+ * A handle to a request submitted to a `jjchannel`, used to collect its response.
+ */
+struct jjchannel_ticket {
+	uint32_t slot;
+	uint32_t generation;
+
+	/**
+	 * @return true if the request was accepted by `submit()`.
+	 */
+	bool valid() const noexcept {
+		return slot != UINT32_MAX;
+	}
+};
+
+/**
+ * A request/response channel between a client thread and a server thread, over a pair of `jjring`s.
+ *
+ * The client submits requests and receives a ticket for each, then collects the responses by ticket, in any order.
+ * Responses are matched to their requests through a fixed table of completion slots indexed by the ticket, so there is no allocation and no lookup by id.
+ * The server processes the pending requests in batches, reading them and writing their responses in place in the rings.
+ * @tparam Req The request type.
+ * @tparam Resp The response type.
+ * @tparam N The size of the rings, allowing up to `N - 1` requests in flight.
+ * @note All client functions must be called from a single thread, and `serve()` from a single other thread.
+ */
+template <typename Req, typename Resp, size_t N>
+class jjchannel {
+public:
+	static_assert(N - 1 < UINT32_MAX, "N is too large");
+	using request_type = Req;
+	using response_type = Resp;
+
+	jjchannel() noexcept {
+		for(size_t i=0; i<slots; ++i) {
+			table[i].generation = 0;
+			table[i].done = false;
+			free_slots[i] = static_cast<uint32_t>(slots - 1 - i);
+		}
+		free_count = slots;
+	}
+	jjchannel(const jjchannel&) = delete;
+	jjchannel& operator=(const jjchannel&) = delete;
+
+	/**
+	 * @return The maximum number of requests in flight.
+	 */
+	constexpr size_t capacity() const noexcept {
+		return slots;
+	}
+	/**
+	 * @return The number of requests whose response has not been collected yet.
+	 * @note This is a client-side operation.
+	 */
+	size_t in_flight() const noexcept {
+		return slots - free_count;
+	}
+
+	/**
+	 * Submit a request.
+	 * @return A ticket to collect the response with, which is not valid if too many requests are in flight.
+	 * @note This is a client-side operation.
+	 */
+	jjchannel_ticket submit(const Req& req) noexcept {
+		if(free_count == 0) {
+			return {UINT32_MAX, 0};
+		}
+		const auto slot = free_slots[--free_count];
+		// There is always room in the request ring, since it can hold as many requests as there are slots
+		requests.push({req, slot});
+		return {slot, table[slot].generation};
+	}
+	/**
+	 * Move the responses received from the server into the completion slots.
+	 * @return The number of responses received.
+	 * @note This is a client-side operation, called by the other client functions.
+	 */
+	size_t poll() noexcept {
+		jjring_span<const response_t> spans[2];
+		const auto n = responses.read_acquire_all(spans);
+		for(size_t s=0; s<2; ++s) {
+			for(size_t i=0; i<spans[s].size; ++i) {
+				const auto& r = spans[s].data[i];
+				table[r.slot].resp = r.resp;
+				table[r.slot].done = true;
+			}
+		}
+		responses.read_commit(n);
+		return n;
+	}
+	/**
+	 * @return true if the response to the given request has been received.
+	 * @note This is a client-side operation.
+	 */
+	bool ready(jjchannel_ticket ticket) noexcept {
+		if(!pending(ticket)) {
+			return false;
+		}
+		poll();
+		return table[ticket.slot].done;
+	}
+	/**
+	 * Collect the response to the given request if it has been received, releasing the ticket.
+	 * @return true if the response was copied, false if it has not been received yet, or if the ticket is not valid or was already released.
+	 * @note This is a client-side operation.
+	 */
+	bool try_get(jjchannel_ticket ticket, Resp& resp) noexcept {
+		if(!ready(ticket)) {
+			return false;
+		}
+		auto& e = table[ticket.slot];
+		resp = e.resp;
+		e.done = false;
+		++e.generation;
+		free_slots[free_count++] = ticket.slot;
+		return true;
+	}
+	/**
+	 * Wait for the response to the given request, yielding to other threads in the meantime, then collect it.
+	 * @return true if the response was copied, false if the ticket is not valid or was already released.
+	 * @note This is a client-side operation.
+	 */
+	bool wait(jjchannel_ticket ticket, Resp& resp) noexcept {
+		if(!pending(ticket)) {
+			return false;
+		}
+		while(!try_get(ticket, resp)) {
+			std::this_thread::yield();
+		}
+		return true;
+	}
+
+	/**
+	 * Process the pending requests in one batch.
+	 * @param fn The function called as `fn(const Req&, Resp&)` for each request, in submission order, to write its response in place.
+	 * @return The number of requests processed.
+	 * @note This is a server-side operation.
+	 */
+	template <typename Fn>
+	size_t serve(Fn&& fn) {
+		jjring_span<const request_t> in[2];
+		jjring_span<response_t> out[2];
+		const auto available = requests.read_acquire_all(in);
+		if(available == 0) {
+			return 0;
+		}
+		// Every request in flight has a free response, so this is only a safeguard
+		const auto room = responses.write_acquire_all(out);
+		const auto n = available < room? available : room;
+		size_t si = 0, ii = 0, so = 0, io = 0;
+		for(size_t k=0; k<n; ++k) {
+			if(ii == in[si].size) {
+				++si;
+				ii = 0;
+			}
+			if(io == out[so].size) {
+				++so;
+				io = 0;
+			}
+			const auto& req = in[si].data[ii++];
+			auto& resp = out[so].data[io++];
+			fn(req.req, resp.resp);
+			resp.slot = req.slot;
+		}
+		responses.write_commit(n);
+		requests.read_commit(n);
+		return n;
+	}
+private:
+	static constexpr size_t slots = N - 1;
+
+	struct request_t {
+		Req req;
+		uint32_t slot;
+	};
+	struct response_t {
+		Resp resp;
+		uint32_t slot;
+	};
+	struct entry_t {
+		Resp resp;
+		uint32_t generation;
+		bool done;
+	};
+
+	bool pending(jjchannel_ticket ticket) const noexcept {
+		return ticket.slot < slots && table[ticket.slot].generation == ticket.generation;
+	}
+
+	jjring<request_t, N> requests;
+	jjring<response_t, N> responses;
+	// Client-side state
+	entry_t table[slots];
+	uint32_t free_slots[slots];
+	size_t free_count;
+};
+
+template <typename Req, typename Resp, size_t N>
+constexpr size_t jjchannel<Req, Resp, N>::slots;
@@ -0,0 +1,86 @@
+#include "../ext/doctest.h"
+#include "jjchannel.hpp"
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+TEST_SUITE_BEGIN("jjchannel");
+
+TEST_CASE("[jjchannel] responses are collected by ticket in any order") {
+	jjchannel<int, int, 4> channel; // 3 requests in flight
+	CHECK(channel.capacity() == 3);
+	const auto a = channel.submit(1);
+	const auto b = channel.submit(2);
+	const auto c = channel.submit(3);
+	CHECK(a.valid() == true);
+	CHECK(c.valid() == true);
+	CHECK(channel.submit(4).valid() == false);
+	CHECK(channel.in_flight() == 3);
+
+	int r;
+	CHECK(channel.ready(b) == false);
+	CHECK(channel.try_get(b, r) == false);
+	CHECK(channel.serve([](const int& req, int& resp) { resp = req * 10; }) == 3);
+	CHECK(channel.serve([](const int&, int&) { FAIL("no request"); }) == 0);
+
+	CHECK(channel.try_get(c, r) == true);
+	CHECK(r == 30);
+	CHECK(channel.try_get(a, r) == true);
+	CHECK(r == 10);
+	CHECK(channel.in_flight() == 1);
+	CHECK(channel.wait(b, r) == true);
+	CHECK(r == 20);
+	CHECK(channel.in_flight() == 0);
+}
+
+TEST_CASE("[jjchannel] released tickets are rejected after their slot is reused") {
+	jjchannel<int, int, 2> channel; // 1 request in flight
+	int r;
+	const auto a = channel.submit(1);
+	channel.serve([](const int& req, int& resp) { resp = req; });
+	CHECK(channel.try_get(a, r) == true);
+	CHECK(channel.try_get(a, r) == false);
+	CHECK(channel.wait(a, r) == false);
+
+	const auto b = channel.submit(2);
+	CHECK(b.slot == a.slot);
+	channel.serve([](const int& req, int& resp) { resp = req; });
+	CHECK(channel.ready(a) == false);
+	CHECK(channel.ready(b) == true);
+	CHECK(channel.try_get(a, r) == false);
+	CHECK(channel.try_get(b, r) == true);
+	CHECK(r == 2);
+	CHECK(channel.try_get(jjchannel_ticket{UINT32_MAX, 0}, r) == false);
+}
+
+TEST_CASE("[jjchannel][wrap][threads] client and server threads exchange requests") {
+	jjchannel<uint32_t, uint64_t, 8> channel;
+	std::atomic<bool> stop(false);
+	std::thread server([&] {
+		while(!stop.load()) {
+			if(channel.serve([](const uint32_t& req, uint64_t& resp) { resp = uint64_t(req) * req; }) == 0) {
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	constexpr uint32_t count = 20000;
+	jjchannel_ticket tickets[3];
+	bool matched = true;
+	for(uint32_t i=0; i<count; i+=3) {
+		for(uint32_t k=0; k<3; ++k) {
+			tickets[k] = channel.submit(i + k);
+		}
+		// Collect in reverse order
+		for(uint32_t k=3; k-->0;) {
+			uint64_t r = 0;
+			matched = matched && channel.wait(tickets[k], r) && r == uint64_t(i + k) * (i + k);
+		}
+	}
+	stop = true;
+	server.join();
+	CHECK(matched == true);
+	CHECK(channel.in_flight() == 0);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,265 @@
+#pragma once
+#include "jjring.hpp"
+#include <cstddef>
+#include <cstdint>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/**
+ * @file
+ * Sample format conversion kernels, and bulk pops converting directly out of `jjring` sample rings.
+ *
+ * The kernels are selected at compile time: AVX2 when built with `-mavx2`, SSSE3/SSE2 on x86, NEON on ARM, with scalar loops for the tails and for other targets.
+ */
+
+/**
+ * A packed, little-endian, signed 24-bit sample.
+ */
+struct jjs24 {
+	uint8_t b[3];
+};
+
+/**
+ * @return The given sample, as a 32-bit signed integer.
+ */
+constexpr int32_t jjconvert_int(int16_t v) {
+	return v;
+}
+constexpr int32_t jjconvert_int(jjs24 v) {
+	return static_cast<int32_t>(uint32_t(v.b[0]) << 8 | uint32_t(v.b[1]) << 16 | uint32_t(v.b[2]) << 24) >> 8;
+}
+
+/**
+ * @return The given sample, converted to float and multiplied by `scale`.
+ */
+template <typename T>
+constexpr float jjconvert_sample(T v, float scale) {
+	return static_cast<float>(jjconvert_int(v)) * scale;
+}
+
+/**
+ * Convert `size` samples to float, multiplying them by `scale`.
+ */
+inline void jjconvert(const int16_t* in, float* out, size_t size, float scale) {
+	size_t i = 0;
+#if defined(__AVX2__)
+	const __m256 s = _mm256_set1_ps(scale);
+	for(; i+16<=size; i+=16) {
+		const __m256i a = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+		const __m256i b = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 8)));
+		_mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(a), s));
+		_mm256_storeu_ps(out + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(b), s));
+	}
+#elif defined(__SSE2__)
+	const __m128 s = _mm_set1_ps(scale);
+	for(; i+8<=size; i+=8) {
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+		// Duplicate each sample into both halves of a 32-bit lane, then shift down to sign-extend it
+		const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+		const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), s));
+		_mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), s));
+	}
+#elif defined(__ARM_NEON)
+	const float32x4_t s = vdupq_n_f32(scale);
+	for(; i+8<=size; i+=8) {
+		const int16x8_t v = vld1q_s16(in + i);
+		vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), s));
+		vst1q_f32(out + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), s));
+	}
+#endif
+	for(; i<size; ++i) {
+		out[i] = jjconvert_sample(in[i], scale);
+	}
+}
+
+/**
+ * Convert `size` samples to float, multiplying them by `scale`.
+ * @note Plain SSE2 has no byte shuffle, so 24-bit samples need SSSE3 or AVX2 to be vectorized on x86.
+ */
+inline void jjconvert(const jjs24* in, float* out, size_t size, float scale) {
+	static_assert(sizeof(jjs24) == 3, "jjs24 must be packed");
+	size_t i = 0;
+#if defined(__AVX2__)
+	const auto bytes = reinterpret_cast<const uint8_t*>(in);
+	const __m256 s = _mm256_set1_ps(scale);
+	// Move each sample into the upper 3 bytes of a 32-bit lane, then shift down to sign-extend it
+	const __m256i shuffle = _mm256_setr_epi8(
+		-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+		-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11
+	);
+	// Each 16-byte load covers 4 samples and 4 bytes past them
+	for(; i+10<=size; i+=8) {
+		const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i * 3));
+		const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i * 3 + 12));
+		const __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+		const __m256i x = _mm256_srai_epi32(_mm256_shuffle_epi8(v, shuffle), 8);
+		_mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), s));
+	}
+#elif defined(__SSSE3__)
+	const auto bytes = reinterpret_cast<const uint8_t*>(in);
+	const __m128 s = _mm_set1_ps(scale);
+	const __m128i shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+	for(; i+6<=size; i+=4) {
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i * 3));
+		const __m128i x = _mm_srai_epi32(_mm_shuffle_epi8(v, shuffle), 8);
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(x), s));
+	}
+#elif defined(__ARM_NEON)
+	const auto bytes = reinterpret_cast<const uint8_t*>(in);
+	const float32x4_t s = vdupq_n_f32(scale);
+	for(; i+16<=size; i+=16) {
+		const uint8x16x3_t v = vld3q_u8(bytes + i * 3);
+		// Low 16 bits from the first two bytes, sign-extended high 16 bits from the last one
+		const uint16x8_t lo[2] = {
+			vorrq_u16(vmovl_u8(vget_low_u8(v.val[0])), vshlq_n_u16(vmovl_u8(vget_low_u8(v.val[1])), 8)),
+			vorrq_u16(vmovl_u8(vget_high_u8(v.val[0])), vshlq_n_u16(vmovl_u8(vget_high_u8(v.val[1])), 8)),
+		};
+		const int16x8_t hi[2] = {
+			vmovl_s8(vget_low_s8(vreinterpretq_s8_u8(v.val[2]))),
+			vmovl_s8(vget_high_s8(vreinterpretq_s8_u8(v.val[2]))),
+		};
+		for(size_t k=0; k<2; ++k) {
+			const int32x4_t a = vorrq_s32(vshlq_n_s32(vmovl_s16(vget_low_s16(hi[k])), 16), vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(lo[k]))));
+			const int32x4_t b = vorrq_s32(vshlq_n_s32(vmovl_s16(vget_high_s16(hi[k])), 16), vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(lo[k]))));
+			vst1q_f32(out + i + k * 8, vmulq_f32(vcvtq_f32_s32(a), s));
+			vst1q_f32(out + i + k * 8 + 4, vmulq_f32(vcvtq_f32_s32(b), s));
+		}
+	}
+#endif
+	for(; i<size; ++i) {
+		out[i] = jjconvert_sample(in[i], scale);
+	}
+}
+
+/**
+ * Convert `frames` frames of `Channels` interleaved samples to float, multiplying them by `scale`, into one planar buffer per channel.
+ * @param out Array of `Channels` destination pointers, each receiving `frames` samples.
+ */
+template <size_t Channels, typename T>
+inline void jjconvert_deinterleave(const T* in, float* const* out, size_t frames, float scale) {
+	static_assert(Channels > 0, "Channels must be greater than zero");
+	for(size_t f=0; f<frames; ++f) {
+		for(size_t c=0; c<Channels; ++c) {
+			out[c][f] = jjconvert_sample(in[f * Channels + c], scale);
+		}
+	}
+}
+
+template <>
+inline void jjconvert_deinterleave<1, int16_t>(const int16_t* in, float* const* out, size_t frames, float scale) {
+	jjconvert(in, out[0], frames, scale);
+}
+
+template <>
+inline void jjconvert_deinterleave<1, jjs24>(const jjs24* in, float* const* out, size_t frames, float scale) {
+	jjconvert(in, out[0], frames, scale);
+}
+
+template <>
+inline void jjconvert_deinterleave<2, int16_t>(const int16_t* in, float* const* out, size_t frames, float scale) {
+	size_t f = 0;
+	float* l = out[0];
+	float* r = out[1];
+#if defined(__AVX2__)
+	const __m256 s = _mm256_set1_ps(scale);
+	for(; f+8<=frames; f+=8) {
+		const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + f * 2));
+		// Left samples are the sign-extended low halves of each 32-bit lane, right samples the high halves
+		const __m256i lv = _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16);
+		const __m256i rv = _mm256_srai_epi32(v, 16);
+		_mm256_storeu_ps(l + f, _mm256_mul_ps(_mm256_cvtepi32_ps(lv), s));
+		_mm256_storeu_ps(r + f, _mm256_mul_ps(_mm256_cvtepi32_ps(rv), s));
+	}
+#elif defined(__SSE2__)
+	const __m128 s = _mm_set1_ps(scale);
+	for(; f+4<=frames; f+=4) {
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + f * 2));
+		const __m128i lv = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+		const __m128i rv = _mm_srai_epi32(v, 16);
+		_mm_storeu_ps(l + f, _mm_mul_ps(_mm_cvtepi32_ps(lv), s));
+		_mm_storeu_ps(r + f, _mm_mul_ps(_mm_cvtepi32_ps(rv), s));
+	}
+#elif defined(__ARM_NEON)
+	const float32x4_t s = vdupq_n_f32(scale);
+	for(; f+8<=frames; f+=8) {
+		const int16x8x2_t v = vld2q_s16(in + f * 2);
+		vst1q_f32(l + f, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v.val[0]))), s));
+		vst1q_f32(l + f + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v.val[0]))), s));
+		vst1q_f32(r + f, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v.val[1]))), s));
+		vst1q_f32(r + f + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v.val[1]))), s));
+	}
+#endif
+	for(; f<frames; ++f) {
+		l[f] = jjconvert_sample(in[f * 2], scale);
+		r[f] = jjconvert_sample(in[f * 2 + 1], scale);
+	}
+}
+
+/**
+ * Pop up to `size` samples from the ring, converting them to float and multiplying them by `scale` on the way.
+ * Samples are read directly from the ring memory, on both sides of the wrap point.
+ * @return The number of samples popped.
+ * @note This is a consumer-side operation.
+ */
+template <typename T, size_t N, typename Policy>
+size_t jjring_pop_convert(jjring<T, N, Policy>& ring, float* dst, size_t size, float scale) noexcept {
+	size_t done = 0;
+	// At most two spans: up to the wrap point, then from the start of the buffer
+	for(size_t k=0; k<2 && done<size; ++k) {
+		const T* src;
+		auto n = ring.read_acquire(&src);
+		if(n == 0) {
+			break;
+		}
+		if(n > size - done) {
+			n = size - done;
+		}
+		jjconvert(src, dst + done, n, scale);
+		ring.read_commit(n);
+		done += n;
+	}
+	return done;
+}
+
+/**
+ * Pop up to `frames` whole frames of `Channels` interleaved samples from the ring, converting them to float, multiplying them by `scale` and deinterleaving them on the way.
+ * Samples are read directly from the ring memory, on both sides of the wrap point.
+ * @param dst Array of `Channels` destination pointers, each receiving up to `frames` samples.
+ * @return The number of frames popped.
+ * @note This is a consumer-side operation. Incomplete frames are left in the ring.
+ */
+template <size_t Channels, typename T, size_t N, typename Policy>
+size_t jjring_consume_convert(jjring<T, N, Policy>& ring, float* const* dst, size_t frames, float scale) noexcept {
+	float* out[Channels];
+	size_t done = 0;
+	while(done < frames) {
+		for(size_t c=0; c<Channels; ++c) {
+			out[c] = dst[c] + done;
+		}
+		const T* src;
+		const auto n = ring.read_acquire(&src);
+		auto f = n / Channels;
+		if(f > 0) {
+			if(f > frames - done) {
+				f = frames - done;
+			}
+			jjconvert_deinterleave<Channels>(src, out, f, scale);
+			ring.read_commit(f * Channels);
+			done += f;
+			continue;
+		}
+		// A frame straddles the wrap point, or is still incomplete
+		if(n == 0 || ring.size_approx() < Channels) {
+			break;
+		}
+		T frame[Channels];
+		ring.pop(frame, Channels);
+		jjconvert_deinterleave<Channels>(frame, out, 1, scale);
+		++done;
+	}
+	return done;
+}
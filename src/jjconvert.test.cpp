@@ -0,0 +1,123 @@
+#include "../ext/doctest.h"
+#include "jjconvert.hpp"
+#include <random>
+#include <vector>
+
+TEST_SUITE_BEGIN("jjconvert");
+
+static jjs24 jjconvert_test_s24(int32_t v) {
+	const auto u = static_cast<uint32_t>(v);
+	return jjs24{{static_cast<uint8_t>(u), static_cast<uint8_t>(u >> 8), static_cast<uint8_t>(u >> 16)}};
+}
+
+TEST_CASE("[jjconvert] scalar sample conversion") {
+	CHECK(jjconvert_int(int16_t(-32768)) == -32768);
+	CHECK(jjconvert_int(jjconvert_test_s24(0)) == 0);
+	CHECK(jjconvert_int(jjconvert_test_s24(-1)) == -1);
+	CHECK(jjconvert_int(jjconvert_test_s24(8388607)) == 8388607);
+	CHECK(jjconvert_int(jjconvert_test_s24(-8388608)) == -8388608);
+	CHECK(jjconvert_sample(int16_t(16384), 1.f / 32768) == 0.5f);
+}
+
+TEST_CASE("[jjconvert] kernels match the scalar reference for all lengths") {
+	std::mt19937 rng(0x5A5A);
+	std::uniform_int_distribution<int> dist16(-32768, 32767);
+	std::uniform_int_distribution<int32_t> dist24(-8388608, 8388607);
+	const float scale = 1.f / 8388608;
+
+	for(size_t size=0; size<70; ++size) {
+		std::vector<int16_t> in16(size);
+		std::vector<jjs24> in24(size);
+		for(size_t i=0; i<size; ++i) {
+			in16[i] = static_cast<int16_t>(dist16(rng));
+			in24[i] = jjconvert_test_s24(dist24(rng));
+		}
+		std::vector<float> out16(size + 1, -2.f);
+		std::vector<float> out24(size + 1, -2.f);
+		jjconvert(in16.data(), out16.data(), size, scale);
+		jjconvert(in24.data(), out24.data(), size, scale);
+		for(size_t i=0; i<size; ++i) {
+			CHECK(out16[i] == jjconvert_sample(in16[i], scale));
+			CHECK(out24[i] == jjconvert_sample(in24[i], scale));
+		}
+		CHECK(out16[size] == -2.f);
+		CHECK(out24[size] == -2.f);
+	}
+}
+
+TEST_CASE("[jjconvert] deinterleave matches the scalar reference") {
+	const float scale = 1.f / 32768;
+	for(size_t frames=0; frames<40; ++frames) {
+		std::vector<int16_t> in(frames * 3);
+		for(size_t i=0; i<in.size(); ++i) {
+			in[i] = static_cast<int16_t>(i * 1031 - 20000);
+		}
+		std::vector<float> a(frames), b(frames), c(frames);
+		float* stereo[2] = {a.data(), b.data()};
+		jjconvert_deinterleave<2>(in.data(), stereo, frames, scale);
+		for(size_t f=0; f<frames; ++f) {
+			CHECK(a[f] == jjconvert_sample(in[f * 2], scale));
+			CHECK(b[f] == jjconvert_sample(in[f * 2 + 1], scale));
+		}
+		float* three[3] = {a.data(), b.data(), c.data()};
+		jjconvert_deinterleave<3>(in.data(), three, frames, scale);
+		for(size_t f=0; f<frames; ++f) {
+			CHECK(a[f] == jjconvert_sample(in[f * 3], scale));
+			CHECK(b[f] == jjconvert_sample(in[f * 3 + 1], scale));
+			CHECK(c[f] == jjconvert_sample(in[f * 3 + 2], scale));
+		}
+	}
+}
+
+TEST_CASE("[jjconvert][wrap] pop_convert reads across the wrap point") {
+	jjring<int16_t, 32> ring; // capacity = 31
+	int16_t in[31];
+	for(int i=0; i<31; ++i) {
+		in[i] = static_cast<int16_t>(i * 100 - 1500);
+	}
+	CHECK(ring.push(in, 20) == 20);
+	int16_t scratch[20];
+	CHECK(ring.pop(scratch, 20) == 20); // t=h=20
+	CHECK(ring.push(in, 25) == 25); // wraps after 12
+
+	float out[31];
+	CHECK(jjring_pop_convert(ring, out, 3, 0.5f) == 3);
+	CHECK(jjring_pop_convert(ring, out + 3, 31, 0.5f) == 22);
+	for(int i=0; i<25; ++i) {
+		CHECK(out[i] == in[i] * 0.5f);
+	}
+	CHECK(ring.empty() == true);
+	CHECK(jjring_pop_convert(ring, out, 31, 0.5f) == 0);
+}
+
+TEST_CASE("[jjconvert][wrap] consume_convert deinterleaves frames straddling the wrap point") {
+	jjring<jjs24, 16> ring; // capacity = 15
+	jjs24 in[15];
+	for(int i=0; i<15; ++i) {
+		in[i] = jjconvert_test_s24(i * 1000 - 7000);
+	}
+	jjs24 scratch[15];
+	CHECK(ring.push(in, 7) == 7);
+	CHECK(ring.pop(scratch, 7) == 7); // t=h=7
+	CHECK(ring.push(in, 14) == 14); // wraps after 9, the third frame straddles
+
+	float l[8], r[8];
+	float* dst[2] = {l, r};
+	CHECK(jjring_consume_convert<2>(ring, dst, 8, 1.f) == 7);
+	for(int f=0; f<7; ++f) {
+		CHECK(l[f] == float(f * 2000 - 7000));
+		CHECK(r[f] == float(f * 2000 - 6000));
+	}
+	CHECK(ring.empty() == true);
+
+	// Incomplete frames are left in the ring
+	CHECK(ring.push(in[0]) == true);
+	CHECK(jjring_consume_convert<2>(ring, dst, 8, 1.f) == 0);
+	CHECK(ring.size_approx() == 1);
+	CHECK(ring.push(in[1]) == true);
+	CHECK(jjring_consume_convert<2>(ring, dst, 8, 1.f) == 1);
+	CHECK(l[0] == -7000.f);
+	CHECK(r[0] == -6000.f);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,164 @@
+#include "jjflash.hpp"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+jjflash::~jjflash() {
+	close();
+}
+
+bool jjflash::open(const char* path, const jjflash_geometry& geometry) noexcept {
+	close();
+	if(geometry.page_size == 0 || geometry.block_size % geometry.page_size != 0 || geometry.block_count == 0) {
+		return false;
+	}
+
+	// The contents, then the page flags, then the erase counters
+	const auto data_size = geometry.block_size * geometry.block_count;
+	const auto pages = data_size / geometry.page_size;
+	const auto counters_offset = (data_size + pages + sizeof(uint32_t) - 1) / sizeof(uint32_t) * sizeof(uint32_t);
+	const auto size = counters_offset + geometry.block_count * sizeof(uint32_t);
+
+	const int f = ::open(path, O_RDWR | O_CREAT, 0600);
+	if(f < 0) {
+		return false;
+	}
+	struct stat st;
+	if(fstat(f, &st) != 0) {
+		::close(f);
+		return false;
+	}
+	const bool fresh = static_cast<size_t>(st.st_size) != size;
+	if(fresh && (ftruncate(f, 0) != 0 || ftruncate(f, static_cast<off_t>(size)) != 0)) {
+		::close(f);
+		return false;
+	}
+	void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, f, 0);
+	if(p == MAP_FAILED) {
+		::close(f);
+		return false;
+	}
+
+	geo = geometry;
+	fd = f;
+	map = p;
+	map_size = size;
+	data = static_cast<uint8_t*>(p);
+	programmed = data + data_size;
+	counters = reinterpret_cast<uint32_t*>(data + counters_offset);
+	if(fresh) {
+		// The file was zero-filled: erase the contents, page flags and counters are already clear
+		std::memset(data, 0xFF, data_size);
+	}
+	reset_stats();
+	return true;
+}
+
+void jjflash::close() noexcept {
+	if(map == nullptr) {
+		return;
+	}
+	munmap(map, map_size);
+	::close(fd);
+	map = nullptr;
+	map_size = 0;
+	fd = -1;
+	data = programmed = nullptr;
+	counters = nullptr;
+}
+
+bool jjflash::read(size_t address, uint8_t* out, size_t size) noexcept {
+	if(!in_bounds(address, size)) {
+		return false;
+	}
+	std::memcpy(out, data + address, size);
+	elapsed += geo.read_setup_ns + uint64_t(geo.read_byte_ns) * size;
+	read_bytes += size;
+	return true;
+}
+
+bool jjflash::program(size_t address, const uint8_t* in, size_t size) noexcept {
+	if(!in_bounds(address, size)) {
+		return false;
+	}
+	if(size == 0) {
+		return true;
+	}
+	const auto first_page = address / geo.page_size;
+	const auto last_page = (address + size - 1) / geo.page_size;
+	if(geo.kind == jjflash_kind::nand) {
+		if(address % geo.page_size != 0 || size % geo.page_size != 0) {
+			return false;
+		}
+		for(size_t page=first_page; page<=last_page; ++page) {
+			if(programmed[page]) {
+				return false;
+			}
+		}
+	} else {
+		// Programming can only clear bits
+		for(size_t i=0; i<size; ++i) {
+			if((data[address + i] & in[i]) != in[i]) {
+				return false;
+			}
+		}
+	}
+	for(size_t i=0; i<size; ++i) {
+		data[address + i] &= in[i];
+	}
+	std::memset(programmed + first_page, 1, last_page - first_page + 1);
+	elapsed += uint64_t(geo.program_page_ns) * (last_page - first_page + 1);
+	programmed_bytes += size;
+	return true;
+}
+
+bool jjflash::erase(size_t block) noexcept {
+	if(block >= geo.block_count) {
+		return false;
+	}
+	const auto pages_per_block = geo.block_size / geo.page_size;
+	std::memset(data + block * geo.block_size, 0xFF, geo.block_size);
+	std::memset(programmed + block * pages_per_block, 0, pages_per_block);
+	++counters[block];
+	elapsed += geo.erase_block_ns;
+	return true;
+}
+
+bool jjflash::is_erased(size_t address, size_t size) const noexcept {
+	if(!in_bounds(address, size)) {
+		return false;
+	}
+	for(size_t i=0; i<size; ++i) {
+		if(data[address + i] != 0xFF) {
+			return false;
+		}
+	}
+	if(geo.kind == jjflash_kind::nand && size > 0) {
+		for(size_t page=address / geo.page_size; page<=(address + size - 1) / geo.page_size; ++page) {
+			if(programmed[page]) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+uint32_t jjflash::max_erase_count() const noexcept {
+	uint32_t m = 0;
+	for(size_t i=0; i<geo.block_count; ++i) {
+		if(counters[i] > m) {
+			m = counters[i];
+		}
+	}
+	return m;
+}
+
+uint64_t jjflash::total_erase_count() const noexcept {
+	uint64_t total = 0;
+	for(size_t i=0; i<geo.block_count; ++i) {
+		total += counters[i];
+	}
+	return total;
+}
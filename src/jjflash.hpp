@@ -0,0 +1,199 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * The programming rules of an emulated flash memory.
+ */
+enum class jjflash_kind {
+	/**
+	 * Programming can only clear bits, any number of times between erases, at any address.
+	 * Programs that would leave different data than requested, by needing to set bits, are rejected.
+	 */
+	nor,
+	/**
+	 * Programming writes whole pages, each page at most once between erases.
+	 */
+	nand,
+};
+
+/**
+ * The geometry and timing of an emulated flash memory.
+ * The default values are typical of a 16-block SPI NOR flash.
+ */
+struct jjflash_geometry {
+	jjflash_kind kind = jjflash_kind::nor;
+	size_t page_size = 256;
+	size_t block_size = 4096;
+	size_t block_count = 16;
+	/**
+	 * The fixed cost of a read command, in nanoseconds.
+	 */
+	uint32_t read_setup_ns = 1000;
+	/**
+	 * The cost of each byte read, in nanoseconds.
+	 */
+	uint32_t read_byte_ns = 20;
+	/**
+	 * The cost of programming each page, in nanoseconds.
+	 */
+	uint32_t program_page_ns = 700000;
+	/**
+	 * The cost of erasing each block, in nanoseconds.
+	 */
+	uint32_t erase_block_ns = 45000000;
+};
+
+/**
+ * A host-side emulation of a NOR or NAND flash memory, backed by a memory-mapped file, to measure flash behavior without hardware.
+ *
+ * Erased bytes read as 0xFF, programming must follow the erase-before-write rules of the flash kind, and erases work on whole blocks.
+ * Operations do not sleep: their cost is accumulated on a simulated clock, see `elapsed_ns()`.
+ * The per-block erase counters are kept in the file along with the contents, so that wear accumulates across runs.
+ */
+class jjflash {
+public:
+	jjflash() noexcept {}
+	~jjflash();
+	jjflash(const jjflash&) = delete;
+	jjflash& operator=(const jjflash&) = delete;
+
+	/**
+	 * Open the backing file, creating an erased flash if it does not exist or does not match the geometry.
+	 * @param path Path of the backing file.
+	 * @param geometry The geometry of the flash memory, whose page size must divide the block size.
+	 * @return true if the backing file was opened and mapped successfully.
+	 */
+	bool open(const char* path, const jjflash_geometry& geometry) noexcept;
+	void close() noexcept;
+	bool is_open() const noexcept {
+		return map != nullptr;
+	}
+	const jjflash_geometry& geometry() const noexcept {
+		return geo;
+	}
+	/**
+	 * @return The size of the flash memory, in bytes.
+	 */
+	size_t size() const noexcept {
+		return geo.block_size * geo.block_count;
+	}
+
+	/**
+	 * Read from the flash memory.
+	 * @return true if the range lies within the flash memory.
+	 */
+	bool read(size_t address, uint8_t* out, size_t size) noexcept;
+	/**
+	 * Program the flash memory.
+	 * @return true if the data was programmed, false if the range is out of bounds or breaks the erase-before-write rules, in which case nothing is programmed.
+	 * @note NAND programs must be page-aligned, and cover whole pages.
+	 */
+	bool program(size_t address, const uint8_t* data, size_t size) noexcept;
+	/**
+	 * Erase a block, setting all its bytes to 0xFF.
+	 * @return true if the block exists.
+	 */
+	bool erase(size_t block) noexcept;
+	/**
+	 * @return true if the whole range is erased and can be programmed with any data.
+	 */
+	bool is_erased(size_t address, size_t size) const noexcept;
+
+	/**
+	 * @return The number of times the block has been erased.
+	 */
+	uint32_t erase_count(size_t block) const noexcept {
+		return counters[block];
+	}
+	/**
+	 * @return The highest erase count among all blocks.
+	 */
+	uint32_t max_erase_count() const noexcept;
+	/**
+	 * @return The total number of erases of all blocks.
+	 */
+	uint64_t total_erase_count() const noexcept;
+
+	/**
+	 * @return The simulated time spent in flash operations since opening or the last `reset_stats()`, in nanoseconds.
+	 */
+	uint64_t elapsed_ns() const noexcept {
+		return elapsed;
+	}
+	/**
+	 * @return The number of bytes read since opening or the last `reset_stats()`.
+	 */
+	uint64_t bytes_read() const noexcept {
+		return read_bytes;
+	}
+	/**
+	 * @return The number of bytes programmed since opening or the last `reset_stats()`.
+	 */
+	uint64_t bytes_programmed() const noexcept {
+		return programmed_bytes;
+	}
+	/**
+	 * Reset the simulated clock and the byte counters. Erase counters are kept.
+	 */
+	void reset_stats() noexcept {
+		elapsed = 0;
+		read_bytes = 0;
+		programmed_bytes = 0;
+	}
+private:
+	bool in_bounds(size_t address, size_t size) const noexcept {
+		return address <= this->size() && size <= this->size() - address;
+	}
+
+	jjflash_geometry geo;
+	void* map = nullptr;
+	size_t map_size = 0;
+	int fd = -1;
+	uint8_t* data = nullptr;
+	uint8_t* programmed = nullptr; // Per page, since the last erase
+	uint32_t* counters = nullptr; // Per block
+	uint64_t elapsed = 0;
+	uint64_t read_bytes = 0;
+	uint64_t programmed_bytes = 0;
+};
+
+/**
+ * Maps the slots of a `jjrecord` to a region of a `jjflash`, providing its `read_fn` and `write_fn`.
+ *
+ * Slot `i` is stored at `base + i * Record::size`. Writing a slot first erases the blocks starting within it, so slots should be laid out so that block boundaries fall on slot boundaries:
+ * with slots smaller than a block, writing the first slot of a block erases the other slots of that block.
+ * @tparam Record The `jjrecord` type.
+ */
+template <typename Record>
+class jjflash_slots {
+public:
+	/**
+	 * @param flash The flash memory.
+	 * @param base The address of the first slot, which should be block-aligned.
+	 */
+	jjflash_slots(jjflash& flash, size_t base = 0) noexcept : flash(flash), base(base) {}
+
+	/**
+	 * Read the start of a slot, to be used as `read_fn`.
+	 */
+	bool read(size_t slot_index, uint8_t* out, size_t size) noexcept {
+		return flash.read(base + slot_index * Record::size, out, size);
+	}
+	/**
+	 * Erase the blocks starting within a slot, then program it, to be used as `write_fn`.
+	 */
+	bool write(size_t slot_index, const uint8_t* data, size_t size) noexcept {
+		const auto address = base + slot_index * Record::size;
+		const auto block_size = flash.geometry().block_size;
+		for(size_t block=(address + block_size - 1) / block_size; block*block_size<address+size; ++block) {
+			if(!flash.erase(block)) {
+				return false;
+			}
+		}
+		return flash.program(address, data, size);
+	}
+private:
+	jjflash& flash;
+	const size_t base;
+};
@@ -0,0 +1,183 @@
+#include "../ext/doctest.h"
+#include "test.hpp"
+#include "jjflash.hpp"
+#include "jjrecord.hpp"
+#include <cstdio>
+
+TEST_SUITE_BEGIN("jjflash");
+
+TEST_CASE("[jjflash][nor] programming clears bits until the block is erased") {
+	test_file_t file;
+	jjflash flash;
+	jjflash_geometry geometry;
+	geometry.block_count = 4;
+	REQUIRE(flash.open(file.path.c_str(), geometry));
+	CHECK(flash.size() == 4 * 4096);
+	CHECK(flash.is_erased(0, flash.size()) == true);
+
+	uint8_t b = 0;
+	CHECK(flash.read(100, &b, 1) == true);
+	CHECK(b == 0xFF);
+	const uint8_t f0 = 0xF0, c0 = 0xC0, ff = 0xFF;
+	CHECK(flash.program(100, &f0, 1) == true);
+	CHECK(flash.program(100, &c0, 1) == true); // Clears more bits
+	CHECK(flash.program(100, &f0, 1) == false); // Would set bits
+	CHECK(flash.program(100, &ff, 1) == false); // Would not store the given data
+	CHECK(flash.read(100, &b, 1) == true);
+	CHECK(b == 0xC0);
+	CHECK(flash.is_erased(0, 4096) == false);
+	CHECK(flash.is_erased(4096, 4096) == true);
+
+	CHECK(flash.erase(0) == true);
+	CHECK(flash.read(100, &b, 1) == true);
+	CHECK(b == 0xFF);
+	CHECK(flash.erase(4) == false);
+	CHECK(flash.read(flash.size() - 1, &b, 2) == false);
+	CHECK(flash.program(flash.size(), &f0, 1) == false);
+	CHECK(flash.erase_count(0) == 1);
+	CHECK(flash.erase_count(1) == 0);
+}
+
+TEST_CASE("[jjflash][nand] pages are programmed whole and once per erase") {
+	test_file_t file;
+	jjflash flash;
+	jjflash_geometry geometry;
+	geometry.kind = jjflash_kind::nand;
+	geometry.page_size = 512;
+	geometry.block_size = 2048;
+	geometry.block_count = 2;
+	REQUIRE(flash.open(file.path.c_str(), geometry));
+
+	uint8_t page[1024];
+	std::fill_n(page, sizeof(page), 0xFF);
+	CHECK(flash.program(10, page, 512) == false);
+	CHECK(flash.program(0, page, 100) == false);
+	CHECK(flash.program(0, page, 1024) == true);
+	CHECK(flash.is_erased(0, 512) == false); // Programmed, even with 0xFF
+	CHECK(flash.program(512, page, 512) == false);
+	CHECK(flash.program(1024, page, 512) == true);
+	CHECK(flash.erase(0) == true);
+	CHECK(flash.program(512, page, 512) == true);
+}
+
+TEST_CASE("[jjflash] operations accumulate simulated time") {
+	test_file_t file;
+	jjflash flash;
+	jjflash_geometry geometry;
+	REQUIRE(flash.open(file.path.c_str(), geometry));
+	uint8_t buffer[400] = {};
+	CHECK(flash.read(0, buffer, 300) == true);
+	CHECK(flash.elapsed_ns() == 1000 + 300 * 20);
+	CHECK(flash.program(200, buffer, 400) == true); // 3 pages
+	CHECK(flash.elapsed_ns() == 1000 + 300 * 20 + 3 * 700000);
+	CHECK(flash.erase(1) == true);
+	CHECK(flash.elapsed_ns() == 1000 + 300 * 20 + 3 * 700000 + 45000000);
+	CHECK(flash.bytes_read() == 300);
+	CHECK(flash.bytes_programmed() == 400);
+	flash.reset_stats();
+	CHECK(flash.elapsed_ns() == 0);
+	CHECK(flash.erase_count(1) == 1);
+}
+
+TEST_CASE("[jjflash] contents and erase counters persist across reopening") {
+	test_file_t file;
+	jjflash_geometry geometry;
+	geometry.block_count = 2;
+	const uint8_t value = 0x42;
+	{
+		jjflash flash;
+		REQUIRE(flash.open(file.path.c_str(), geometry));
+		CHECK(flash.erase(1) == true);
+		CHECK(flash.program(5000, &value, 1) == true);
+	}
+	jjflash flash;
+	REQUIRE(flash.open(file.path.c_str(), geometry));
+	uint8_t b = 0;
+	CHECK(flash.read(5000, &b, 1) == true);
+	CHECK(b == 0x42);
+	CHECK(flash.erase_count(1) == 1);
+	CHECK(flash.total_erase_count() == 1);
+
+	// Another geometry starts over
+	geometry.block_count = 3;
+	REQUIRE(flash.open(file.path.c_str(), geometry));
+	CHECK(flash.is_erased(0, flash.size()) == true);
+	CHECK(flash.total_erase_count() == 0);
+}
+
+TEST_CASE("[jjflash][jjrecord] records rotate over flash slots") {
+	test_file_t file;
+	jjflash flash;
+	jjflash_geometry geometry;
+	geometry.block_count = 2;
+	REQUIRE(flash.open(file.path.c_str(), geometry));
+
+	using record_t = jjrecord<0x77, 1024, 8, jjrecord_check_crc16<>, uint16_t>;
+	jjflash_slots<record_t> slots(flash);
+	const auto read = [&](size_t i, uint8_t* out, size_t size) { return slots.read(i, out, size); };
+	const auto write = [&](size_t i, const uint8_t* data, size_t size) { return slots.write(i, data, size); };
+
+	record_t writer;
+	for(int i=0; i<100; ++i) {
+		writer.payload()[0] = static_cast<uint8_t>(i);
+		REQUIRE(writer.write_next(write));
+	}
+	// Slots 0 and 4 start a block
+	CHECK(flash.erase_count(0) == 12);
+	CHECK(flash.erase_count(1) == 13);
+
+	record_t a, b, c;
+	CHECK(a.read(read) == true);
+	CHECK(b.read_newest_first(read) == true);
+	CHECK(c.read_bisect(read) == true);
+	CHECK(a.payload()[0] == 99);
+	CHECK(b.payload()[0] == 99);
+	CHECK(c.payload()[0] == 99);
+	CHECK(c.current_slot().sequence_number == 100);
+}
+
+template <size_t Size, size_t Redundancy>
+static void jjflash_bench_record(const char* path) {
+	using record_t = jjrecord<0x77, Size, Redundancy, jjrecord_check_crc16<>, uint16_t>;
+	jjflash flash;
+	jjflash_geometry geometry;
+	geometry.block_count = (record_t::total_size + geometry.block_size - 1) / geometry.block_size;
+	std::remove(path);
+	REQUIRE(flash.open(path, geometry));
+	jjflash_slots<record_t> slots(flash);
+	const auto read = [&](size_t i, uint8_t* out, size_t size) { return slots.read(i, out, size); };
+	const auto write = [&](size_t i, const uint8_t* data, size_t size) { return slots.write(i, data, size); };
+
+	constexpr size_t writes = 1000;
+	record_t writer;
+	for(size_t i=0; i<writes; ++i) {
+		REQUIRE(writer.write_next(write));
+	}
+	const auto write_ms = double(flash.elapsed_ns()) / writes / 1e6;
+
+	const auto boot_ms = [&](bool (record_t::*fn)(decltype(read)&)) {
+		flash.reset_stats();
+		record_t record;
+		CHECK((record.*fn)(read));
+		return double(flash.elapsed_ns()) / 1e6;
+	};
+	MESSAGE(Size << " B x " << Redundancy << " slots in " << geometry.block_count << " blocks: write " << write_ms << " ms"
+		<< ", max erases " << flash.max_erase_count() << " for " << writes << " writes"
+		<< ", boot read " << boot_ms(&record_t::template read<decltype(read)&>) << " ms"
+		<< ", newest first " << boot_ms(&record_t::template read_newest_first<decltype(read)&>) << " ms"
+		<< ", bisect " << boot_ms(&record_t::template read_bisect<decltype(read)&>) << " ms");
+	flash.close();
+}
+
+TEST_CASE("[jjflash][bench] jjrecord geometry on a simulated SPI NOR flash" * doctest::skip()) {
+	test_file_t file;
+	jjflash_bench_record<64, 64>(file.path.c_str());
+	jjflash_bench_record<256, 16>(file.path.c_str());
+	jjflash_bench_record<256, 64>(file.path.c_str());
+	jjflash_bench_record<1024, 8>(file.path.c_str());
+	jjflash_bench_record<4096, 2>(file.path.c_str());
+	jjflash_bench_record<4096, 8>(file.path.c_str());
+	jjflash_bench_record<4096, 64>(file.path.c_str());
+}
+
+TEST_SUITE_END();
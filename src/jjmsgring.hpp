@@ -0,0 +1,158 @@
+#pragma once
+#include "jjring.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+/**
+ * @return The index of `T` in `Ts`, or `sizeof...(Ts)` if it is not one of them.
+ */
+template <typename T>
+constexpr size_t jjmsgring_index() {
+	return 0;
+}
+template <typename T, typename U, typename... Ts>
+constexpr size_t jjmsgring_index() {
+	return __is_same(T, U)? 0 : 1 + jjmsgring_index<T, Ts...>();
+}
+
+/**
+ * @return The largest alignment of `Ts`, and at least `a`.
+ */
+template <size_t a>
+constexpr size_t jjmsgring_align() {
+	return a;
+}
+template <size_t a, typename T, typename... Ts>
+constexpr size_t jjmsgring_align() {
+	return jjmsgring_align<(alignof(T) > a)? alignof(T) : a, Ts...>();
+}
+
+/**
+ * A single-producer, single-consumer ring of heterogeneous messages, each stored as a type tag followed by exactly its own bytes.
+ *
+ * The ring is a `jjring_` of cells, the size of the header or the largest alignment of the messages if it is larger.
+ * A message takes one header cell plus as many cells as its size needs, and never wraps around the end of the buffer, so that it can be handed to the consumer in place.
+ * When a message does not fit before the end, the remaining cells are skipped with a padding header committed together with the message.
+ * @tparam N The number of cells (must be a power of 2).
+ * @tparam Msgs The message types, which must be trivially copyable.
+ */
+template <size_t N, typename... Msgs>
+class jjmsgring {
+	struct header_t {
+		uint16_t tag;
+		uint16_t cells;
+	};
+public:
+	static_assert(sizeof...(Msgs) > 0 && sizeof...(Msgs) < UINT16_MAX, "There must be between 1 and 65534 message types");
+	static_assert(N > 1 && (N & (N - 1)) == 0, "N must be a power of 2");
+	static_assert(N - 1 <= UINT16_MAX, "N is too large");
+	static constexpr size_t cell = jjmsgring_align<sizeof(header_t), Msgs...>();
+
+	jjmsgring() noexcept : ring(storage, N, cell, cell) {}
+	jjmsgring(const jjmsgring&) = delete;
+	jjmsgring& operator=(const jjmsgring&) = delete;
+
+	/**
+	 * @return The number of cells taken by a message of type `Msg`, including its header.
+	 */
+	template <typename Msg>
+	static constexpr size_t cells() noexcept {
+		return 1 + (sizeof(Msg) + cell - 1) / cell;
+	}
+
+	/**
+	 * Clear the ring.
+	 * @warning This operation is not thread-safe and should only be called when the buffer is not being accessed by other threads.
+	 */
+	void clear() noexcept {
+		ring.clear();
+	}
+	/**
+	 * @return true if the ring holds no message.
+	 */
+	bool empty() const noexcept {
+		return ring.empty();
+	}
+
+	/**
+	 * Push a message.
+	 * @return true if the message was pushed, false if there is not enough contiguous room for it.
+	 * @note This is a producer-side operation.
+	 */
+	template <typename Msg>
+	bool push(const Msg& msg) noexcept {
+		static_assert(__is_trivially_copyable(Msg), "Msg must be trivially copyable");
+		constexpr auto tag = jjmsgring_index<Msg, Msgs...>();
+		static_assert(tag < sizeof...(Msgs), "Msg is not one of the message types of the ring");
+		constexpr auto need = cells<Msg>();
+		static_assert(need < N, "Msg is too large for the ring");
+
+		jjring_span<void> spans[2];
+		ring.write_acquire_all(spans);
+		char* p;
+		size_t skip = 0;
+		if(spans[0].size >= need) {
+			p = static_cast<char*>(spans[0].data);
+		} else if(spans[1].size >= need) {
+			// Skip the end of the buffer
+			skip = spans[0].size;
+			new(spans[0].data) header_t{pad, static_cast<uint16_t>(skip)};
+			p = static_cast<char*>(spans[1].data);
+		} else {
+			return false;
+		}
+		new(p) header_t{static_cast<uint16_t>(tag), static_cast<uint16_t>(need)};
+		new(p + cell) Msg(msg);
+		ring.write_commit(skip + need);
+		return true;
+	}
+
+	/**
+	 * Pass the available messages in order to a visitor, in place, then remove them.
+	 * @param visitor The function object called with `const Msg&` for each message, with an overload for each message type.
+	 * @param max The maximum number of messages to dispatch.
+	 * @return The number of messages dispatched.
+	 * @note This is a consumer-side operation. The messages are only valid during the call to the visitor.
+	 */
+	template <typename Visitor>
+	size_t dispatch(Visitor&& visitor, size_t max = SIZE_MAX) {
+		using fn_t = void (*)(const void*, Visitor&);
+		static constexpr fn_t table[] = {&call<Msgs, Visitor>...};
+
+		jjring_span<const void> spans[2];
+		ring.read_acquire_all(spans);
+		size_t count = 0;
+		size_t consumed = 0;
+		for(size_t s=0; s<2 && count<max; ++s) {
+			const auto base = static_cast<const char*>(spans[s].data);
+			size_t i = 0;
+			while(i < spans[s].size && count < max) {
+				const auto h = reinterpret_cast<const header_t*>(base + i * cell);
+				if(h->tag != pad) {
+					table[h->tag](base + (i + 1) * cell, visitor);
+					++count;
+				}
+				i += h->cells;
+			}
+			consumed += i;
+		}
+		ring.read_commit(consumed);
+		return count;
+	}
+private:
+	static constexpr uint16_t pad = UINT16_MAX;
+
+	template <typename Msg, typename Visitor>
+	static void call(const void* p, Visitor& visitor) {
+		visitor(*static_cast<const Msg*>(p));
+	}
+
+	alignas(cell) char storage[N * cell];
+	jjring_ ring;
+};
+
+template <size_t N, typename... Msgs>
+constexpr size_t jjmsgring<N, Msgs...>::cell;
+template <size_t N, typename... Msgs>
+constexpr uint16_t jjmsgring<N, Msgs...>::pad;
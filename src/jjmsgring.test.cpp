@@ -0,0 +1,137 @@
+#include "../ext/doctest.h"
+#include "jjmsgring.hpp"
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+TEST_SUITE_BEGIN("jjmsgring");
+
+struct jjmsgring_small_t {
+	uint8_t value;
+};
+struct jjmsgring_point_t {
+	int32_t x, y;
+};
+struct jjmsgring_large_t {
+	double values[5];
+};
+
+struct jjmsgring_visitor_t {
+	std::vector<int> seen;
+
+	void operator()(const jjmsgring_small_t& m) {
+		seen.push_back(m.value);
+	}
+	void operator()(const jjmsgring_point_t& m) {
+		seen.push_back(m.x + m.y);
+	}
+	void operator()(const jjmsgring_large_t& m) {
+		CHECK(reinterpret_cast<uintptr_t>(&m) % alignof(double) == 0);
+		seen.push_back(static_cast<int>(m.values[4]));
+	}
+};
+
+using jjmsgring_test_t = jjmsgring<16, jjmsgring_small_t, jjmsgring_point_t, jjmsgring_large_t>;
+
+TEST_CASE("[jjmsgring] messages take only their own size") {
+	CHECK(jjmsgring_test_t::cell == 8);
+	CHECK(jjmsgring_test_t::cells<jjmsgring_small_t>() == 2);
+	CHECK(jjmsgring_test_t::cells<jjmsgring_point_t>() == 2);
+	CHECK(jjmsgring_test_t::cells<jjmsgring_large_t>() == 6);
+	CHECK(jjmsgring<8, jjmsgring_small_t>::cell == 4);
+	CHECK(jjmsgring<8, jjmsgring_small_t>::cells<jjmsgring_small_t>() == 2);
+}
+
+TEST_CASE("[jjmsgring] dispatch calls the right overload in order") {
+	jjmsgring_test_t ring; // 15 cells
+	jjmsgring_visitor_t v;
+	CHECK(ring.dispatch(v) == 0);
+	CHECK(ring.push(jjmsgring_small_t{7}) == true);
+	CHECK(ring.push(jjmsgring_point_t{3, 4}) == true);
+	CHECK(ring.push(jjmsgring_large_t{{0, 0, 0, 0, 9}}) == true);
+	CHECK(ring.push(jjmsgring_large_t{}) == false); // 10 cells used
+	CHECK(ring.push(jjmsgring_small_t{1}) == true);
+
+	CHECK(ring.dispatch(v, 2) == 2);
+	CHECK(ring.dispatch(v) == 2);
+	CHECK(ring.empty() == true);
+	CHECK(v.seen == std::vector<int>{7, 7, 9, 1});
+}
+
+TEST_CASE("[jjmsgring][wrap] messages never straddle the wrap point") {
+	jjmsgring_test_t ring;
+	jjmsgring_visitor_t v;
+	for(int i=0; i<5; ++i) {
+		CHECK(ring.push(jjmsgring_point_t{i, 0}) == true); // 10 cells
+	}
+	CHECK(ring.dispatch(v) == 5);
+	// The large message fits exactly before the end, the next ones start over
+	CHECK(ring.push(jjmsgring_large_t{{0, 0, 0, 0, 10}}) == true); // 10..16
+	CHECK(ring.push(jjmsgring_small_t{11}) == true); // 0..2
+	CHECK(ring.push(jjmsgring_large_t{{0, 0, 0, 0, 12}}) == true); // 2..8
+	CHECK(ring.dispatch(v) == 3);
+
+	// The 4 cells left before the end are padded
+	CHECK(ring.push(jjmsgring_point_t{20, 0}) == true); // 8..10
+	CHECK(ring.push(jjmsgring_point_t{21, 0}) == true); // 10..12
+	CHECK(ring.push(jjmsgring_large_t{{0, 0, 0, 0, 22}}) == true); // 0..6
+	CHECK(ring.dispatch(v) == 3);
+
+	// Not enough room at the end nor at the start
+	for(int i=30; i<34; ++i) {
+		CHECK(ring.push(jjmsgring_point_t{i, 0}) == true); // 6..14
+	}
+	CHECK(ring.push(jjmsgring_large_t{}) == false);
+	CHECK(ring.push(jjmsgring_small_t{34}) == true); // 14..16
+	CHECK(ring.dispatch(v) == 5);
+	CHECK(v.seen == std::vector<int>{0, 1, 2, 3, 4, 10, 11, 12, 20, 21, 22, 30, 31, 32, 33, 34});
+}
+
+TEST_CASE("[jjmsgring][threads] producer and consumer threads exchange mixed messages") {
+	jjmsgring<64, jjmsgring_small_t, jjmsgring_point_t, jjmsgring_large_t> ring;
+	constexpr int count = 30000;
+	std::thread producer([&] {
+		for(int i=0; i<count;) {
+			bool pushed;
+			switch(i % 3) {
+				case 0: pushed = ring.push(jjmsgring_small_t{static_cast<uint8_t>(i)}); break;
+				case 1: pushed = ring.push(jjmsgring_point_t{i, 1}); break;
+				default: pushed = ring.push(jjmsgring_large_t{{0, 0, 0, 0, double(i)}}); break;
+			}
+			if(pushed) {
+				++i;
+			} else {
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	int expected = 0;
+	bool ordered = true;
+	struct {
+		int& expected;
+		bool& ordered;
+		void operator()(const jjmsgring_small_t& m) {
+			ordered = ordered && expected % 3 == 0 && m.value == static_cast<uint8_t>(expected);
+			++expected;
+		}
+		void operator()(const jjmsgring_point_t& m) {
+			ordered = ordered && expected % 3 == 1 && m.x == expected && m.y == 1;
+			++expected;
+		}
+		void operator()(const jjmsgring_large_t& m) {
+			ordered = ordered && expected % 3 == 2 && m.values[4] == double(expected);
+			++expected;
+		}
+	} visitor{expected, ordered};
+	while(expected < count) {
+		if(ring.dispatch(visitor) == 0) {
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+	CHECK(ordered == true);
+}
+
+TEST_SUITE_END();
@@ -2,6 +2,12 @@
 #include <cstddef>
 #include <cstdint>
 #include <algorithm>
+#include <limits>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+#include <arm_neon.h>
+#endif
 
 /**
  * Calculate the CRC-16-CCITT of the given data.
@@ -24,18 +30,453 @@ constexpr uint16_t jjrecord_crc16(const uint8_t* data, size_t size, uint16_t crc
 }
 
 /**
- * The size of the record header, in bytes.
+ * Lookup tables for the CRC-16-CCITT, generated at compile time.
+ * `t[0][b]` is the CRC of the byte `b` from a zero state, and `t[k][b]` the CRC of `b` followed by `k` zero bytes.
+ * @tparam Slices The number of tables, which is the number of bytes processed per step.
+ */
+template <size_t Slices>
+struct jjrecord_crc16_tables {
+	uint16_t t[Slices][256];
+
+	constexpr jjrecord_crc16_tables() : t{} {
+		for(size_t b=0; b<256; ++b) {
+			const uint8_t byte = static_cast<uint8_t>(b);
+			t[0][b] = jjrecord_crc16(&byte, 1, 0);
+		}
+		for(size_t k=1; k<Slices; ++k) {
+			for(size_t b=0; b<256; ++b) {
+				t[k][b] = static_cast<uint16_t>((t[k-1][b] << 8) ^ t[0][t[k-1][b] >> 8]);
+			}
+		}
+	}
+
+	static const jjrecord_crc16_tables value;
+};
+
+template <size_t Slices>
+constexpr jjrecord_crc16_tables<Slices> jjrecord_crc16_tables<Slices>::value{};
+
+/**
+ * The XOR of the table lookups for bytes `K` to `Slices - 1` of a step, unrolled at compile time.
+ */
+template <size_t Slices, size_t K>
+struct jjrecord_crc16_slices_ {
+	static constexpr uint16_t lookup(const uint16_t (&t)[Slices][256], const uint8_t* data) {
+		return t[Slices-1-K][data[K]] ^ jjrecord_crc16_slices_<Slices, K+1>::lookup(t, data);
+	}
+};
+template <size_t Slices>
+struct jjrecord_crc16_slices_<Slices, Slices> {
+	static constexpr uint16_t lookup(const uint16_t (&)[Slices][256], const uint8_t*) {
+		return 0;
+	}
+};
+
+/**
+ * Calculate the CRC-16-CCITT of the given data, with 8 bytes per step using slicing-by-8 tables when `Slices` is 8, or 4 bytes per step when it is 4, then one byte per step using the first table.
+ * @note The result is bit-exact with `jjrecord_crc16()`.
+ */
+template <size_t Slices>
+constexpr uint16_t jjrecord_crc16_sliced(const uint8_t* data, size_t size, uint16_t crc = 0xFFFF) {
+	static_assert(Slices == 1 || Slices == 4 || Slices == 8, "Slices must be 1, 4 or 8");
+	const auto& t = jjrecord_crc16_tables<Slices>::value.t;
+	size_t i = 0;
+	for(; i + Slices <= size && Slices > 1; i += Slices) {
+		// The CRC only affects the first two bytes of each step
+		constexpr size_t second = (Slices > 1)? Slices - 2 : 0;
+		crc = t[Slices-1][data[i] ^ (crc >> 8)] ^ t[second][data[i+1] ^ (crc & 0xFF)]
+			^ jjrecord_crc16_slices_<Slices, (Slices > 2)? 2 : Slices>::lookup(t, data + i);
+	}
+	for(; i<size; ++i) {
+		crc = static_cast<uint16_t>((crc << 8) ^ t[0][(crc >> 8) ^ data[i]]);
+	}
+	return crc;
+}
+
+/**
+ * Calculate the CRC-16-CCITT of `Lanes` buffers of the same size at once, interleaving their slicing-by-8 steps.
+ * Each buffer is a separate dependency chain through the table lookups, so interleaving them keeps more lookups in flight than computing the CRCs one after the other.
+ * @param data The buffers.
+ * @param crcs The initial CRC of each buffer, usually 0xFFFF, which receives the CRC of each buffer.
+ * @note The results are bit-exact with `jjrecord_crc16()`.
+ */
+template <size_t Lanes>
+inline void jjrecord_crc16_multi(const uint8_t* const* data, size_t size, uint16_t* crcs) noexcept {
+	const auto& t = jjrecord_crc16_tables<8>::value.t;
+	uint16_t c[Lanes];
+	for(size_t l=0; l<Lanes; ++l) {
+		c[l] = crcs[l];
+	}
+	size_t i = 0;
+	for(; i+8<=size; i+=8) {
+#pragma GCC unroll 16
+		for(size_t l=0; l<Lanes; ++l) {
+			const auto p = data[l] + i;
+			c[l] = t[7][p[0] ^ (c[l] >> 8)] ^ t[6][p[1] ^ (c[l] & 0xFF)] ^ jjrecord_crc16_slices_<8, 2>::lookup(t, p);
+		}
+	}
+	for(; i<size; ++i) {
+#pragma GCC unroll 16
+		for(size_t l=0; l<Lanes; ++l) {
+			c[l] = static_cast<uint16_t>((c[l] << 8) ^ t[0][(c[l] >> 8) ^ data[l][i]]);
+		}
+	}
+	for(size_t l=0; l<Lanes; ++l) {
+		crcs[l] = c[l];
+	}
+}
+
+/**
+ * @defgroup crc16 CRC-16 implementations
+ * @brief Policies selecting how `jjrecord` computes the CRC-16-CCITT, all giving the same result.
+ *
+ * - `jjrecord_crc16_bitwise`: no table, 8 iterations per byte, for the smallest code size. This is the default.
+ * - `jjrecord_crc16_table`: a 512-byte table, one lookup per byte.
+ * - `jjrecord_crc16_slice4`: 2 KB of tables, 4 bytes per step.
+ * - `jjrecord_crc16_slice8`: 4 KB of tables, 8 bytes per step.
+ * - `jjrecord_crc16_clmul`: carry-less multiplication, for the highest throughput on large slots (see below).
+ */
+struct jjrecord_crc16_bitwise {
+	static constexpr uint16_t compute(const uint8_t* data, size_t size, uint16_t crc = 0xFFFF) {
+		return jjrecord_crc16(data, size, crc);
+	}
+};
+struct jjrecord_crc16_table {
+	static constexpr uint16_t compute(const uint8_t* data, size_t size, uint16_t crc = 0xFFFF) {
+		return jjrecord_crc16_sliced<1>(data, size, crc);
+	}
+};
+struct jjrecord_crc16_slice4 {
+	static constexpr uint16_t compute(const uint8_t* data, size_t size, uint16_t crc = 0xFFFF) {
+		return jjrecord_crc16_sliced<4>(data, size, crc);
+	}
+};
+struct jjrecord_crc16_slice8 {
+	static constexpr uint16_t compute(const uint8_t* data, size_t size, uint16_t crc = 0xFFFF) {
+		return jjrecord_crc16_sliced<8>(data, size, crc);
+	}
+};
+
+/**
+ * @return x^n modulo the CRC-16-CCITT polynomial, used as folding constant.
+ */
+constexpr uint64_t jjrecord_crc16_xpow(size_t n) {
+	uint32_t r = 1;
+	for(size_t i=0; i<n; ++i) {
+		r <<= 1;
+		if(r & 0x10000) {
+			r ^= 0x11021;
+		}
+	}
+	return r;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JJRECORD_CLMUL_TARGET __attribute__((target("pclmul,ssse3")))
+
+/**
+ * Load 16 bytes as a 128-bit polynomial, the first byte holding the highest degree coefficients.
+ */
+JJRECORD_CLMUL_TARGET inline __m128i jjrecord_clmul_load_(const uint8_t* p) noexcept {
+	const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	return _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), reverse);
+}
+
+/**
+ * @return A polynomial congruent to `a * x^D + b`, where `k` holds x^(D+64) and x^D modulo the polynomial in its high and low halves.
+ */
+JJRECORD_CLMUL_TARGET inline __m128i jjrecord_clmul_fold_(__m128i a, __m128i k, __m128i b) noexcept {
+	return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(a, k, 0x11), _mm_clmulepi64_si128(a, k, 0x00)), b);
+}
+
+/**
+ * Calculate the CRC-16-CCITT of at least 16 bytes, folding 128-bit blocks with carry-less multiplications down to a 16-byte remainder that is finished with the slicing-by-8 tables.
+ * @warning Only call when the CPU supports PCLMULQDQ and SSSE3.
+ */
+JJRECORD_CLMUL_TARGET inline uint16_t jjrecord_crc16_clmul_(const uint8_t* data, size_t size, uint16_t crc) noexcept {
+	const __m128i k128 = _mm_set_epi64x(jjrecord_crc16_xpow(128 + 64), jjrecord_crc16_xpow(128));
+	// The CRC so far is added to the first two bytes
+	__m128i a = _mm_xor_si128(jjrecord_clmul_load_(data), _mm_set_epi64x(static_cast<int64_t>(uint64_t(crc) << 48), 0));
+	size_t i = 16;
+	if(size >= 64) {
+		// Four independent accumulators, 64 bytes apart, to hide the multiplication latency
+		const __m128i k512 = _mm_set_epi64x(jjrecord_crc16_xpow(512 + 64), jjrecord_crc16_xpow(512));
+		__m128i b = jjrecord_clmul_load_(data + 16);
+		__m128i c = jjrecord_clmul_load_(data + 32);
+		__m128i d = jjrecord_clmul_load_(data + 48);
+		for(i=64; i+64<=size; i+=64) {
+			a = jjrecord_clmul_fold_(a, k512, jjrecord_clmul_load_(data + i));
+			b = jjrecord_clmul_fold_(b, k512, jjrecord_clmul_load_(data + i + 16));
+			c = jjrecord_clmul_fold_(c, k512, jjrecord_clmul_load_(data + i + 32));
+			d = jjrecord_clmul_fold_(d, k512, jjrecord_clmul_load_(data + i + 48));
+		}
+		const __m128i k384 = _mm_set_epi64x(jjrecord_crc16_xpow(384 + 64), jjrecord_crc16_xpow(384));
+		const __m128i k256 = _mm_set_epi64x(jjrecord_crc16_xpow(256 + 64), jjrecord_crc16_xpow(256));
+		a = jjrecord_clmul_fold_(a, k384, jjrecord_clmul_fold_(b, k256, jjrecord_clmul_fold_(c, k128, d)));
+	}
+	for(; i+16<=size; i+=16) {
+		a = jjrecord_clmul_fold_(a, k128, jjrecord_clmul_load_(data + i));
+	}
+	uint8_t rest[16];
+	const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(rest), _mm_shuffle_epi8(a, reverse));
+	crc = jjrecord_crc16_sliced<8>(rest, 16, 0);
+	return jjrecord_crc16_sliced<8>(data + i, size - i, crc);
+}
+
+#undef JJRECORD_CLMUL_TARGET
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+
+inline uint64x2_t jjrecord_clmul_load_(const uint8_t* p) noexcept {
+	const uint8x16_t v = vrev64q_u8(vld1q_u8(p));
+	return vreinterpretq_u64_u8(vextq_u8(v, v, 8));
+}
+
+inline uint64x2_t jjrecord_clmul_fold_(uint64x2_t a, uint64_t k_hi, uint64_t k_lo, uint64x2_t b) noexcept {
+	const auto hi = vreinterpretq_u64_p128(vmull_p64(vgetq_lane_u64(a, 1), k_hi));
+	const auto lo = vreinterpretq_u64_p128(vmull_p64(vgetq_lane_u64(a, 0), k_lo));
+	return veorq_u64(veorq_u64(hi, lo), b);
+}
+
+/**
+ * Calculate the CRC-16-CCITT of at least 16 bytes, folding 128-bit blocks with PMULL down to a 16-byte remainder that is finished with the slicing-by-8 tables.
+ */
+inline uint16_t jjrecord_crc16_clmul_(const uint8_t* data, size_t size, uint16_t crc) noexcept {
+	constexpr uint64_t k128_hi = jjrecord_crc16_xpow(128 + 64), k128_lo = jjrecord_crc16_xpow(128);
+	uint64x2_t a = veorq_u64(jjrecord_clmul_load_(data), vcombine_u64(vcreate_u64(0), vcreate_u64(uint64_t(crc) << 48)));
+	size_t i = 16;
+	if(size >= 64) {
+		constexpr uint64_t k512_hi = jjrecord_crc16_xpow(512 + 64), k512_lo = jjrecord_crc16_xpow(512);
+		uint64x2_t b = jjrecord_clmul_load_(data + 16);
+		uint64x2_t c = jjrecord_clmul_load_(data + 32);
+		uint64x2_t d = jjrecord_clmul_load_(data + 48);
+		for(i=64; i+64<=size; i+=64) {
+			a = jjrecord_clmul_fold_(a, k512_hi, k512_lo, jjrecord_clmul_load_(data + i));
+			b = jjrecord_clmul_fold_(b, k512_hi, k512_lo, jjrecord_clmul_load_(data + i + 16));
+			c = jjrecord_clmul_fold_(c, k512_hi, k512_lo, jjrecord_clmul_load_(data + i + 32));
+			d = jjrecord_clmul_fold_(d, k512_hi, k512_lo, jjrecord_clmul_load_(data + i + 48));
+		}
+		d = jjrecord_clmul_fold_(c, k128_hi, k128_lo, d);
+		d = jjrecord_clmul_fold_(b, jjrecord_crc16_xpow(256 + 64), jjrecord_crc16_xpow(256), d);
+		a = jjrecord_clmul_fold_(a, jjrecord_crc16_xpow(384 + 64), jjrecord_crc16_xpow(384), d);
+	}
+	for(; i+16<=size; i+=16) {
+		a = jjrecord_clmul_fold_(a, k128_hi, k128_lo, jjrecord_clmul_load_(data + i));
+	}
+	uint8_t rest[16];
+	vst1q_u8(rest, vrev64q_u8(vextq_u8(vreinterpretq_u8_u64(a), vreinterpretq_u8_u64(a), 8)));
+	crc = jjrecord_crc16_sliced<8>(rest, 16, 0);
+	return jjrecord_crc16_sliced<8>(data + i, size - i, crc);
+}
+
+#endif
+
+/**
+ * Carry-less multiplication folding with PCLMULQDQ on x86 when the CPU supports it, or PMULL on ARMv8 with the crypto extension, for large slots and images.
+ * Falls back to `jjrecord_crc16_slice8` on other CPUs and for buffers under 64 bytes.
+ * @note Unlike the other implementations, this one cannot be used in constant expressions.
+ */
+struct jjrecord_crc16_clmul {
+	static uint16_t compute(const uint8_t* data, size_t size, uint16_t crc = 0xFFFF) noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+		static const bool supported = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+		if(size >= 64 && supported) {
+			return jjrecord_crc16_clmul_(data, size, crc);
+		}
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+		if(size >= 64) {
+			return jjrecord_crc16_clmul_(data, size, crc);
+		}
+#endif
+		return jjrecord_crc16_sliced<8>(data, size, crc);
+	}
+};
+
+/**
+ * Calculate the CRC-32C (Castagnoli) of the given data, bit by bit.
+ * @note Pass the result of a previous call as `crc` to continue a calculation.
+ */
+constexpr uint32_t jjrecord_crc32c(const uint8_t* data, size_t size, uint32_t crc = 0) {
+	constexpr const uint32_t polynomial = 0x82F63B78; // Reflected CRC-32C polynomial
+
+	crc = ~crc;
+	for(size_t i=0; i<size; ++i) {
+		crc ^= data[i];
+		for(size_t j=0; j<8; ++j) {
+			crc = (crc >> 1) ^ ((crc & 1)? polynomial : 0);
+		}
+	}
+	return ~crc;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/**
+ * Calculate the CRC-32C of the given data with the SSE4.2 `crc32` instruction.
+ * @warning Only call when the CPU supports SSE4.2.
+ */
+__attribute__((target("sse4.2"))) inline uint32_t jjrecord_crc32c_sse42_(const uint8_t* data, size_t size, uint32_t crc) noexcept {
+	crc = ~crc;
+	size_t i = 0;
+#if defined(__x86_64__)
+	uint64_t crc64 = crc;
+	for(; i+8<=size; i+=8) {
+		uint64_t v;
+		std::copy_n(data + i, 8, reinterpret_cast<uint8_t*>(&v));
+		crc64 = _mm_crc32_u64(crc64, v);
+	}
+	crc = static_cast<uint32_t>(crc64);
+#endif
+	for(; i<size; ++i) {
+		crc = _mm_crc32_u8(crc, data[i]);
+	}
+	return ~crc;
+}
+#endif
+
+/**
+ * @defgroup integrity Integrity checks
+ * @brief Policies selecting the check stored at the start of each `jjrecord` slot, which determines the header size.
+ *
+ * Each policy defines the `size` of the check in bytes, `seal()` to store it, and `verify()` to validate it, both over the rest of the slot.
+ * The header is followed by the record type and the sequence number, then the payload.
+ */
+
+/**
+ * CRC-16-CCITT, stored little-endian. This is the original on-media format.
+ * @tparam Crc16 The CRC-16 implementation, see @ref crc16.
+ */
+template <typename Crc16 = jjrecord_crc16_bitwise>
+struct jjrecord_check_crc16 {
+	static constexpr size_t size = 2;
+
+	static void seal(uint8_t* slot, size_t slot_size) noexcept {
+		const auto crc = Crc16::compute(slot + size, slot_size - size);
+		slot[0] = static_cast<uint8_t>(crc & 0xFF);
+		slot[1] = static_cast<uint8_t>((crc >> 8) & 0xFF);
+	}
+	static bool verify(const uint8_t* slot, size_t slot_size) noexcept {
+		const auto crc_read = slot[0] | (slot[1] << 8);
+		return crc_read == Crc16::compute(slot + size, slot_size - size);
+	}
+};
+
+template <typename Crc16>
+constexpr size_t jjrecord_check_crc16<Crc16>::size;
+
+/**
+ * CRC-32C, stored little-endian, computed with the SSE4.2 `crc32` instruction when the CPU supports it.
+ * Stronger than CRC-16 and faster on x86, at the cost of 2 more header bytes.
+ */
+struct jjrecord_check_crc32c {
+	static constexpr size_t size = 4;
+
+	/**
+	 * @note Pass the result of a previous call as `crc` to continue a calculation.
+	 */
+	static uint32_t compute(const uint8_t* data, size_t n, uint32_t crc = 0) noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+		static const bool supported = __builtin_cpu_supports("sse4.2");
+		if(supported) {
+			return jjrecord_crc32c_sse42_(data, n, crc);
+		}
+#endif
+		return jjrecord_crc32c(data, n, crc);
+	}
+	static void seal(uint8_t* slot, size_t slot_size) noexcept {
+		const auto crc = compute(slot + size, slot_size - size);
+		for(size_t i=0; i<size; ++i) {
+			slot[i] = static_cast<uint8_t>(crc >> (8 * i));
+		}
+	}
+	static bool verify(const uint8_t* slot, size_t slot_size) noexcept {
+		uint32_t crc_read = 0;
+		for(size_t i=0; i<size; ++i) {
+			crc_read |= uint32_t(slot[i]) << (8 * i);
+		}
+		return crc_read == compute(slot + size, slot_size - size);
+	}
+};
+
+/**
+ * No check at all, for RAM-backed storage and test doubles. Only the record type is validated.
+ */
+struct jjrecord_check_none {
+	static constexpr size_t size = 0;
+
+	static void seal(uint8_t*, size_t) noexcept {}
+	static bool verify(const uint8_t*, size_t) noexcept {
+		return true;
+	}
+};
+
+/**
+ * Verification of many slots of the same size at once with an integrity policy, for slots already in memory.
+ * By default, the slots are verified one after the other with `Integrity::verify()`; policies with a multi-buffer kernel are specialized.
+ */
+template <typename Integrity>
+struct jjrecord_verify_many {
+	/**
+	 * @param slots The memory holding the slots, with slot `i` at `slots + i * slot_size`.
+	 * @param valid Receives for each slot whether its check is valid.
+	 */
+	static void verify(const uint8_t* slots, size_t count, size_t slot_size, bool* valid) noexcept {
+		for(size_t i=0; i<count; ++i) {
+			valid[i] = Integrity::verify(slots + i * slot_size, slot_size);
+		}
+	}
+};
+
+/**
+ * The slicing-by-8 CRC-16 verifies 2 slots at a time with `jjrecord_crc16_multi()`: more lanes run out of registers on x86-64, and end up slower.
+ */
+template <>
+struct jjrecord_verify_many<jjrecord_check_crc16<jjrecord_crc16_slice8>> {
+	static void verify(const uint8_t* slots, size_t count, size_t slot_size, bool* valid) noexcept {
+		using check_t = jjrecord_check_crc16<jjrecord_crc16_slice8>;
+		constexpr size_t lanes = 2;
+		size_t i = 0;
+		for(; i+lanes<=count; i+=lanes) {
+			const uint8_t* data[lanes];
+			uint16_t crcs[lanes];
+			for(size_t l=0; l<lanes; ++l) {
+				data[l] = slots + (i + l) * slot_size + check_t::size;
+				crcs[l] = 0xFFFF;
+			}
+			jjrecord_crc16_multi<lanes>(data, slot_size - check_t::size, crcs);
+			for(size_t l=0; l<lanes; ++l) {
+				const auto slot = slots + (i + l) * slot_size;
+				valid[i + l] = crcs[l] == (slot[0] | (slot[1] << 8));
+			}
+		}
+		for(; i<count; ++i) {
+			valid[i] = check_t::verify(slots + i * slot_size, slot_size);
+		}
+	}
+};
+
+/**
+ * The size of the record header with the default CRC-16 check, in bytes.
  */
 constexpr size_t jjrecord_header_size = 4;
 
+template <typename Record>
+class jjrecord_view;
+template <typename Record>
+class jjrecord_batch;
+template <uint8_t Type, size_t Size, size_t Chunk, size_t Redundancy, typename Crc16, typename Seq>
+class jjrecordstream;
+
 /**
  * A record with rotating slots.
  *
  * @tparam Type The magic number identifying the record type.
  * @tparam Size The size of the record, in bytes.
  * @tparam Redundancy The number of slots to use for rotating copies of the record.
+ * @tparam Integrity The integrity check of each slot, see @ref integrity. The default bitwise CRC-16 keeps the original on-media format and needs no tables; use `jjrecord_check_crc16<jjrecord_crc16_slice8>` or `jjrecord_check_crc16<jjrecord_crc16_clmul>` for faster checks where the tables fit.
+ * @tparam Seq The unsigned type of the sequence numbers, stored little-endian in the slot header. The default 8-bit type keeps the original on-media format and allows up to 128 slots; use a wider one for more.
+ * @tparam Index The unsigned type of the slot indices.
  */
-template <uint8_t Type, size_t Size, uint8_t Redundancy>
+template <uint8_t Type, size_t Size, size_t Redundancy, typename Integrity = jjrecord_check_crc16<>, typename Seq = uint8_t, typename Index = Seq>
 class jjrecord {
 public:
 	/**
@@ -50,17 +491,24 @@ public:
 	 * The number of slots to use for rotating copies of the record.
 	 */
 	static constexpr size_t redundancy = Redundancy;
+	/**
+	 * The size of the slot header (integrity check, type and sequence number), in bytes.
+	 */
+	static constexpr size_t header_size = Integrity::size + 1 + sizeof(Seq);
 	/**
 	 * The size of the payload attached to the record, in bytes.
 	 */
-	static constexpr size_t payload_size = size - jjrecord_header_size;
+	static constexpr size_t payload_size = size - header_size;
 	/**
 	 * The total size taken by the record with all its slots, in bytes.
 	 */
 	static constexpr size_t total_size = size * redundancy;
 
-	static_assert(Size > jjrecord_header_size, "Size must be greater than header size.");
+	static_assert(Size > header_size, "Size must be greater than header size.");
 	static_assert(Redundancy > 0, "Redundancy must be greater than zero.");
+	// Slots are ordered by the distance between sequence numbers, which must tell ahead from behind
+	static_assert(Redundancy <= std::numeric_limits<Seq>::max() / 2 + 1, "Redundancy must be at most half the range of the sequence number type.");
+	static_assert(Redundancy - 1 <= std::numeric_limits<Index>::max(), "Redundancy must fit the slot index type.");
 
 
 	/**
@@ -70,19 +518,19 @@ public:
 		/**
 		* The index of the current slot in the storage area.
 		*/
-		uint8_t index;
+		Index index;
 		/**
 		* The sequence number of the current slot.
 		*/
-		uint8_t sequence_number;
+		Seq sequence_number;
 
 		/**
 		* @return The next slot in the rotation.
 		*/
 		constexpr slot_t next() const {
 			return {
-				static_cast<uint8_t>((index + 1) % Redundancy),
-				static_cast<uint8_t>(sequence_number + 1)
+				static_cast<Index>((index + 1) % Redundancy),
+				static_cast<Seq>(sequence_number + 1)
 			};
 		}
 
@@ -98,14 +546,14 @@ public:
 	 * @return A pointer to the payload data within the record, with size `payload_size` bytes.
 	 */
 	uint8_t* payload() {
-		return data + jjrecord_header_size;
+		return data + header_size;
 	}
 
 	/**
 	 * @return A pointer to the payload data within the record, with size `payload_size` bytes.
 	 */
 	const uint8_t* payload() const {
-		return data + jjrecord_header_size;
+		return data + header_size;
 	}
 
 	/**
@@ -117,7 +565,7 @@ public:
 
 	/**
 	 * Read the record from storage using the given read function into account.
-	 * @param read_fn The function used to read a slot from storage, with signature `bool read_fn(uint8_t slot_index, uint8_t* out, size_t size)`.
+	 * @param read_fn The function used to read a slot from storage, with signature `bool read_fn(Index slot_index, uint8_t* out, size_t size)`.
 	 * @return true if a valid record was found and read, false otherwise.
 	 * @note Use `payload()` to access the read payload data and `current_slot()` to get the corresponding slot.
 	 */
@@ -136,9 +584,181 @@ public:
 		return found;
 	}
 
+	/**
+	 * Read the record from storage, fetching only the slot headers first, then reading and validating full slots from the newest candidate down, stopping at the first valid one.
+	 * Candidates are the slots of the right type; the newest one is selected with the same sequence window rules as `read()`, and is dropped in favor of the next newest if it fails validation.
+	 * On intact storage, this finds the same slot as `read()` with `redundancy` header reads and a single full slot read.
+	 * @param read_fn The function used to read the start of a slot from storage, with signature `bool read_fn(Index slot_index, uint8_t* out, size_t size)`, called with `size` set to `header_size` or to the full slot size.
+	 * @return true if a valid record was found and read, false otherwise.
+	 * @note Use `payload()` to access the read payload data and `current_slot()` to get the corresponding slot.
+	 */
+	template <typename ReadFn>
+	bool read_newest_first(ReadFn&& read_fn) {
+		uint8_t header[header_size];
+		Seq seqnums[redundancy];
+		bool candidates[redundancy];
+		for(size_t i=0; i<redundancy; ++i) {
+			if(!read_fn(static_cast<Index>(i), header, header_size)) {
+				return false;
+			}
+			candidates[i] = parse_header(header, seqnums[i]);
+		}
+		uint8_t temp[size];
+		for(;;) {
+			const auto newest = newest_candidate(candidates, seqnums);
+			if(newest == redundancy) {
+				return false;
+			}
+			if(!read_fn(static_cast<Index>(newest), temp, size)) {
+				return false;
+			}
+			if(read_slot(static_cast<Index>(newest), temp, false)) {
+				return true;
+			}
+			candidates[newest] = false;
+		}
+	}
+
+	/**
+	 * Read the record from storage in O(log n) slot header reads, relying on the layout left by `write_next()` from a default-constructed record: slot sequence numbers increase by one from slot 0 (or slot 1 before the first wrap) up to the newest slot.
+	 * The newest slot is found by binary search on the headers, then read and validated in full, falling back to its predecessor after a torn write, and to `read_newest_first()` when the layout is not as expected.
+	 * @param read_fn The function used to read the start of a slot from storage, with signature `bool read_fn(Index slot_index, uint8_t* out, size_t size)`, called with `size` set to `header_size` or to the full slot size.
+	 * @return true if a valid record was found and read, false otherwise.
+	 * @warning Corrupted headers in the middle of the sequence can mislead the search; only the newest slots are checked.
+	 * @note Use `payload()` to access the read payload data and `current_slot()` to get the corresponding slot.
+	 */
+	template <typename ReadFn>
+	bool read_bisect(ReadFn&& read_fn) {
+		uint8_t header[header_size];
+		bool failed = false;
+		// Anchor on slot 0 once written, otherwise on slot 1 where the first write goes
+		size_t anchor = 0;
+		Seq anchor_seqnum = 0;
+		const auto header_at = [&](size_t i, Seq& seqnum) {
+			if(!read_fn(static_cast<Index>(i), header, header_size)) {
+				failed = true;
+				return false;
+			}
+			return parse_header(header, seqnum);
+		};
+		if(!header_at(0, anchor_seqnum)) {
+			if(failed) {
+				return false;
+			}
+			anchor = 1;
+			if(redundancy < 2 || !header_at(1, anchor_seqnum)) {
+				return failed? false : read_newest_first(read_fn);
+			}
+		}
+		// Find the last slot in sequence with the anchor
+		size_t lo = anchor, hi = redundancy - 1;
+		while(lo < hi) {
+			const auto mid = lo + (hi - lo + 1) / 2;
+			Seq seqnum;
+			if(header_at(mid, seqnum) && Seq(seqnum - anchor_seqnum) == mid - anchor) {
+				lo = mid;
+			} else if(failed) {
+				return false;
+			} else {
+				hi = mid - 1;
+			}
+		}
+		// The next slot must not be newer
+		const auto newest = lo;
+		const auto newest_seqnum = static_cast<Seq>(anchor_seqnum + (newest - anchor));
+		const auto next = (newest + 1) % redundancy;
+		Seq seqnum;
+		if(next != newest && header_at(next, seqnum)) {
+			const Seq distance = Seq(seqnum - newest_seqnum);
+			if(distance != 0 && distance < redundancy) {
+				return read_newest_first(read_fn);
+			}
+		}
+		if(failed) {
+			return false;
+		}
+		// Validate the newest slot, or its predecessor after a torn write
+		uint8_t temp[size];
+		for(size_t k=0; k<2 && k<=newest-anchor; ++k) {
+			const auto i = static_cast<Index>(newest - k);
+			if(!read_fn(i, temp, size)) {
+				return false;
+			}
+			if(read_slot(i, temp, false)) {
+				return true;
+			}
+		}
+		return read_newest_first(read_fn);
+	}
+
+	/**
+	 * Read the record from storage starting from a hint: the slot given by `current_slot()` after the last read or write, kept in a small retained location such as RTC memory or a side file.
+	 * The hinted slot must be valid and hold the hinted sequence number, then the following slots are read for as long as they hold the next sequence numbers, in case writes happened after the hint was stored.
+	 * Otherwise, this falls back to `read()`. With an up-to-date hint, this takes 2 slot reads.
+	 * @param read_fn The function used to read a slot from storage, with signature `bool read_fn(Index slot_index, uint8_t* out, size_t size)`.
+	 * @param hint The hinted slot.
+	 * @return true if a valid record was found and read, false otherwise.
+	 * @note Store the hint after every `write_next()`, including failed ones, so that a torn slot is never skipped over.
+	 */
+	template <typename ReadFn>
+	bool read_hinted(ReadFn&& read_fn, slot_t hint) {
+		uint8_t temp[size];
+		// Only the header is checked here, read_slot() verifies the integrity once the sequence number matches
+		const auto holds = [&](slot_t s) {
+			Seq seqnum;
+			return read_fn(s.index, temp, size) && parse_header(temp, seqnum) && seqnum == s.sequence_number;
+		};
+		if(hint.index >= redundancy || !holds(hint) || !read_slot(hint.index, temp, false)) {
+			return read(read_fn);
+		}
+		for(size_t i=1; i<redundancy; ++i) {
+			const auto next = slot.next();
+			if(!holds(next) || !read_slot(next.index, temp, true)) {
+				break;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Validate all slots of a record held in memory at once, such as a memory-mapped flash window, with the multi-buffer check of the integrity policy when it has one, see `jjrecord_verify_many`.
+	 * @param slots The memory holding the slots, with slot `i` at `slots + i * size`.
+	 * @param valid Receives for each slot whether it is valid and of the right type, `redundancy` values.
+	 * @return The number of valid slots.
+	 */
+	static size_t validate_all(const uint8_t* slots, bool* valid) noexcept {
+		jjrecord_verify_many<Integrity>::verify(slots, redundancy, size, valid);
+		size_t count = 0;
+		for(size_t i=0; i<redundancy; ++i) {
+			valid[i] = valid[i] && slots[i * size + Integrity::size] == type;
+			count += valid[i];
+		}
+		return count;
+	}
+	/**
+	 * Read the record from memory holding all its slots, validated at once with `validate_all()`, with the same rules as `read()`.
+	 * @param slots The memory holding the slots, with slot `i` at `slots + i * size`.
+	 * @return true if a valid record was found and read, false otherwise.
+	 */
+	bool read_all(const uint8_t* slots) {
+		bool valid[redundancy];
+		validate_all(slots, valid);
+		Seq seqnums[redundancy];
+		for(size_t i=0; i<redundancy; ++i) {
+			parse_header(slots + i * size, seqnums[i]);
+		}
+		const auto newest = newest_candidate(valid, seqnums);
+		if(newest == redundancy) {
+			return false;
+		}
+		slot = {static_cast<Index>(newest), seqnums[newest]};
+		std::copy_n(slots + newest * size + header_size, payload_size, data + header_size);
+		return true;
+	}
+
 	/**
 	 * Write the current payload to storage using the given write function, advancing to the next slot.
-	 * @param write_fn The function used to write a slot to storage, with signature `bool write_fn(uint8_t slot_index, const uint8_t* data, size_t size)`.
+	 * @param write_fn The function used to write a slot to storage, with signature `bool write_fn(Index slot_index, const uint8_t* data, size_t size)`.
 	 * @return true if the write was successful, false otherwise.
 	 * @note Before calling this method, prepare the payload data using `payload()`, and ensure the slot is set correctly.
 	 */
@@ -156,19 +776,16 @@ public:
 	 * @return true if the slot was valid and read successfully, false otherwise.
 	 * @note Use `payload()` to access the read payload data and `current_slot()` to get the corresponding slot.
 	 */
-	bool read_slot(uint8_t slot_index, const uint8_t* in, bool check_window = true) {
-		const auto crc_read = in[0] | (in[1] << 8);
-		const auto crc_calc = jjrecord_crc16(in + 2, size - 2);
-		if(crc_read != crc_calc) {
+	bool read_slot(Index slot_index, const uint8_t* in, bool check_window = true) {
+		if(!Integrity::verify(in, size)) {
 			return false;
 		}
-		const auto type_read = in[2];
-		if(type_read != type) {
+		Seq seqnum_read;
+		if(!parse_header(in, seqnum_read)) {
 			return false;
 		}
-		const auto seqnum_read = in[3];
 		if(check_window) {
-			const uint8_t distance = uint8_t(seqnum_read - slot.sequence_number);
+			const Seq distance = Seq(seqnum_read - slot.sequence_number);
 			if(distance >= redundancy) {
 				return false;
 			}
@@ -176,7 +793,7 @@ public:
 
 		slot.sequence_number = seqnum_read;
 		slot.index = slot_index;
-		std::copy_n(in + jjrecord_header_size, payload_size, data + jjrecord_header_size);
+		std::copy_n(in + header_size, payload_size, data + header_size);
 		return true;
 	}
 
@@ -185,14 +802,539 @@ public:
 	 * @return The pointer to the buffer containing the complete slot data, with size `size` bytes.
 	 */
 	const uint8_t* write_slot() {
-		data[2] = type;
-		data[3] = slot.sequence_number;
-		const auto crc = jjrecord_crc16(data + 2, size - 2);
-		data[0] = static_cast<uint8_t>(crc & 0xFF);
-		data[1] = static_cast<uint8_t>((crc >> 8) & 0xFF);
+		seal_slot(data, slot.sequence_number);
 		return data;
 	}
 private:
+	template <typename Record>
+	friend class jjrecord_view;
+	template <typename Record>
+	friend class jjrecord_batch;
+	template <uint8_t, size_t, size_t, size_t, typename, typename>
+	friend class jjrecordstream;
+	using integrity_t = Integrity;
+	using seq_t = Seq;
+
+	/**
+	 * Write the header of a slot and seal it.
+	 */
+	static void seal_slot(uint8_t* out, Seq seqnum) {
+		out[Integrity::size] = type;
+		for(size_t i=0; i<sizeof(Seq); ++i) {
+			out[Integrity::size + 1 + i] = static_cast<uint8_t>(seqnum >> (8 * i));
+		}
+		Integrity::seal(out, size);
+	}
+	/**
+	 * Decode the sequence number of a slot header.
+	 * @return true if the slot has the right type.
+	 */
+	static bool parse_header(const uint8_t* in, Seq& seqnum) {
+		seqnum = 0;
+		for(size_t i=0; i<sizeof(Seq); ++i) {
+			seqnum = static_cast<Seq>(seqnum | Seq(in[Integrity::size + 1 + i]) << (8 * i));
+		}
+		return in[Integrity::size] == type;
+	}
+	/**
+	 * Select the newest candidate slot: a candidate supersedes the current choice when its sequence number is less than `redundancy` ahead.
+	 * @param candidates Whether each slot is a candidate, `redundancy` values.
+	 * @param seqnums The sequence number of each slot, `redundancy` values.
+	 * @return The index of the newest candidate, or `redundancy` if there is none.
+	 */
+	static size_t newest_candidate(const bool* candidates, const Seq* seqnums) noexcept {
+		size_t newest = redundancy;
+		for(size_t i=0; i<redundancy; ++i) {
+			if(candidates[i] && (newest == redundancy || Seq(seqnums[i] - seqnums[newest]) < redundancy)) {
+				newest = i;
+			}
+		}
+		return newest;
+	}
+
 	uint8_t data[size];
 	slot_t slot;
 };
+
+template <uint8_t Type, size_t Size, size_t Redundancy, typename Integrity, typename Seq, typename Index>
+constexpr uint8_t jjrecord<Type, Size, Redundancy, Integrity, Seq, Index>::type;
+template <uint8_t Type, size_t Size, size_t Redundancy, typename Integrity, typename Seq, typename Index>
+constexpr size_t jjrecord<Type, Size, Redundancy, Integrity, Seq, Index>::size;
+template <uint8_t Type, size_t Size, size_t Redundancy, typename Integrity, typename Seq, typename Index>
+constexpr size_t jjrecord<Type, Size, Redundancy, Integrity, Seq, Index>::redundancy;
+template <uint8_t Type, size_t Size, size_t Redundancy, typename Integrity, typename Seq, typename Index>
+constexpr size_t jjrecord<Type, Size, Redundancy, Integrity, Seq, Index>::header_size;
+template <uint8_t Type, size_t Size, size_t Redundancy, typename Integrity, typename Seq, typename Index>
+constexpr size_t jjrecord<Type, Size, Redundancy, Integrity, Seq, Index>::payload_size;
+template <uint8_t Type, size_t Size, size_t Redundancy, typename Integrity, typename Seq, typename Index>
+constexpr size_t jjrecord<Type, Size, Redundancy, Integrity, Seq, Index>::total_size;
+
+/**
+ * Delta writes of a `jjrecord` for byte-addressable storage such as EEPROM or FRAM, where the cost of a write grows with the number of bytes written.
+ *
+ * A copy of the last known image of each slot is kept; writing the next slot only writes the byte ranges that differ from its image, then the changed header bytes last, so that a torn write fails the integrity check like a full write would.
+ * Slot images become known when read through `read()` or after being written; slots with an unknown image are written in full.
+ * Since slots rotate, the image of the next slot is `Record::redundancy` writes old, so each change is written once to every slot.
+ * @tparam Record The `jjrecord` type.
+ * @note This takes `Record::total_size` bytes of memory for the slot images.
+ */
+template <typename Record>
+class jjrecord_delta {
+public:
+	jjrecord_delta() noexcept : known{} {}
+
+	/**
+	 * Read a record with `Record::read()`, remembering the slot images seen.
+	 * @param read_fn The function used to read a slot from storage, with signature `bool read_fn(Index slot_index, uint8_t* out, size_t size)`.
+	 * @return The result of `Record::read()`.
+	 */
+	template <typename ReadFn>
+	bool read(Record& record, ReadFn&& read_fn) {
+		return record.read([&](size_t slot_index, uint8_t* out, size_t size) {
+			if(!read_fn(slot_index, out, size)) {
+				known[slot_index] = false;
+				return false;
+			}
+			std::copy_n(out, Record::size, images[slot_index]);
+			known[slot_index] = true;
+			return true;
+		});
+	}
+
+	/**
+	 * Write the current payload of a record to its next slot, writing only the bytes that changed since the last known image of the slot.
+	 * @param write_range_fn The function used to write a range of a slot to storage, with signature `bool write_range_fn(Index slot_index, size_t offset, const uint8_t* data, size_t size)`.
+	 * @param max_gap Unchanged runs of up to this many bytes between changes are written too, to merge ranges when each write has a fixed cost.
+	 * @return true if the write was successful, false otherwise, in which case the slot image is forgotten.
+	 */
+	template <typename WriteRangeFn>
+	bool write_next(Record& record, WriteRangeFn&& write_range_fn, size_t max_gap = 0) {
+		return record.write_next([&](size_t slot_index, const uint8_t* data, size_t size) {
+			if(!write(slot_index, data, size, write_range_fn, max_gap)) {
+				known[slot_index] = false;
+				return false;
+			}
+			std::copy_n(data, size, images[slot_index]);
+			known[slot_index] = true;
+			return true;
+		});
+	}
+
+	/**
+	 * Forget the slot images, for instance after the storage was modified by other means. The next write of each slot is a full write.
+	 */
+	void invalidate() noexcept {
+		std::fill_n(known, Record::redundancy, false);
+	}
+
+	/**
+	 * @return The number of bytes passed to `write_range_fn` since construction or the last `reset_stats()`.
+	 */
+	size_t bytes_written() const noexcept {
+		return written_bytes;
+	}
+	/**
+	 * @return The number of calls to `write_range_fn` since construction or the last `reset_stats()`.
+	 */
+	size_t ranges_written() const noexcept {
+		return written_ranges;
+	}
+	void reset_stats() noexcept {
+		written_bytes = 0;
+		written_ranges = 0;
+	}
+private:
+	template <typename WriteRangeFn>
+	bool write_range(size_t slot_index, size_t offset, const uint8_t* data, size_t size, WriteRangeFn& write_range_fn) {
+		written_bytes += size;
+		++written_ranges;
+		return write_range_fn(slot_index, offset, data, size);
+	}
+
+	/**
+	 * Write the bytes of `data` in `[begin, end)` that differ from the slot image, merging ranges separated by up to `max_gap` unchanged bytes.
+	 */
+	template <typename WriteRangeFn>
+	bool write_changes(size_t slot_index, const uint8_t* data, size_t begin, size_t end, WriteRangeFn& write_range_fn, size_t max_gap) {
+		const auto image = images[slot_index];
+		size_t pos = begin;
+		while(pos < end) {
+			if(image[pos] == data[pos]) {
+				++pos;
+				continue;
+			}
+			auto last = pos + 1;
+			for(size_t i=last; i<end && i-last<=max_gap; ++i) {
+				if(image[i] != data[i]) {
+					last = i + 1;
+				}
+			}
+			if(!write_range(slot_index, pos, data + pos, last - pos, write_range_fn)) {
+				return false;
+			}
+			pos = last;
+		}
+		return true;
+	}
+
+	template <typename WriteRangeFn>
+	bool write(size_t slot_index, const uint8_t* data, size_t size, WriteRangeFn& write_range_fn, size_t max_gap) {
+		if(!known[slot_index]) {
+			return write_range(slot_index, 0, data, size, write_range_fn);
+		}
+		// The payload first, the header last
+		return write_changes(slot_index, data, Record::header_size, size, write_range_fn, max_gap)
+			&& write_changes(slot_index, data, 0, Record::header_size, write_range_fn, Record::header_size);
+	}
+
+	uint8_t images[Record::redundancy][Record::size];
+	bool known[Record::redundancy];
+	size_t written_bytes = 0;
+	size_t written_ranges = 0;
+};
+
+/**
+ * Write-behind of a `jjrecord` whose payload is updated frequently, such as a setting changed from a user interface.
+ *
+ * Updates change the payload of the record in RAM and mark it dirty; `process()` writes it with `Record::write_next()` only once the updates have stopped for a quiet period, or once the oldest unwritten update reaches a maximum delay.
+ * Times are given by the caller, in milliseconds, and may wrap around.
+ * @tparam Record The `jjrecord` type.
+ * @note Updates not yet written are lost on power failure, call `flush_now()` before shutting down.
+ */
+template <typename Record>
+class jjrecord_writebehind {
+public:
+	/**
+	 * @param record The record to write, whose payload is updated through this object.
+	 * @param quiet_ms The time without updates after which the record is written, in milliseconds.
+	 * @param max_delay_ms The maximum time an update stays unwritten while updates keep coming, in milliseconds.
+	 */
+	jjrecord_writebehind(Record& record, uint32_t quiet_ms, uint32_t max_delay_ms) noexcept : record(record), quiet_ms(quiet_ms), max_delay_ms(max_delay_ms) {}
+	jjrecord_writebehind(const jjrecord_writebehind&) = delete;
+	jjrecord_writebehind& operator=(const jjrecord_writebehind&) = delete;
+
+	/**
+	 * Copy data into the payload of the record.
+	 * @param offset The offset in the payload, in bytes.
+	 * @param t The current time, in milliseconds.
+	 * @return true if the payload changed and is now dirty, false if the data was already there or does not fit the payload.
+	 */
+	bool update(size_t offset, const void* data, size_t size, uint32_t t) noexcept {
+		if(offset > Record::payload_size || size > Record::payload_size - offset) {
+			return false;
+		}
+		const auto in = static_cast<const uint8_t*>(data);
+		const auto out = record.payload() + offset;
+		if(std::equal(in, in + size, out)) {
+			return false;
+		}
+		std::copy_n(in, size, out);
+		modified(t);
+		return true;
+	}
+	/**
+	 * Mark the record dirty after its payload was modified directly through `Record::payload()`.
+	 * @param t The current time, in milliseconds.
+	 */
+	void modified(uint32_t t) noexcept {
+		if(!is_dirty) {
+			is_dirty = true;
+			first_update = t;
+		}
+		last_update = t;
+		++update_count;
+	}
+
+	/**
+	 * Write the record if it is dirty and its quiet period or maximum delay has elapsed.
+	 * @param t The current time, in milliseconds.
+	 * @param write_fn The function used to write a slot to storage, see `Record::write_next()`.
+	 * @return false if the write failed, in which case the record stays dirty and the write is retried on the next call, true otherwise.
+	 */
+	template <typename WriteFn>
+	bool process(uint32_t t, WriteFn&& write_fn) {
+		if(!is_dirty || (t - last_update < quiet_ms && t - first_update < max_delay_ms)) {
+			return true;
+		}
+		return flush_now(write_fn);
+	}
+	/**
+	 * Write the record now if it is dirty, for instance before shutting down.
+	 * @param write_fn The function used to write a slot to storage, see `Record::write_next()`.
+	 * @return false if the write failed, in which case the record stays dirty, true otherwise.
+	 */
+	template <typename WriteFn>
+	bool flush_now(WriteFn&& write_fn) {
+		if(!is_dirty) {
+			return true;
+		}
+		if(!record.write_next(write_fn)) {
+			return false;
+		}
+		is_dirty = false;
+		++flush_count;
+		return true;
+	}
+
+	/**
+	 * @return true if the payload has updates not written yet.
+	 */
+	bool dirty() const noexcept {
+		return is_dirty;
+	}
+	/**
+	 * @return The number of updates since construction.
+	 */
+	size_t updates() const noexcept {
+		return update_count;
+	}
+	/**
+	 * @return The number of records written since construction.
+	 */
+	size_t flushes() const noexcept {
+		return flush_count;
+	}
+private:
+	Record& record;
+	const uint32_t quiet_ms;
+	const uint32_t max_delay_ms;
+	uint32_t first_update = 0;
+	uint32_t last_update = 0;
+	bool is_dirty = false;
+	size_t update_count = 0;
+	size_t flush_count = 0;
+};
+
+/**
+ * A view of a `jjrecord` whose slots stay in external memory, such as a memory-mapped flash window or a buffer owned by the caller, to avoid keeping a copy of the payload in RAM.
+ *
+ * Slots are validated in place, and `payload()` points to the payload of the newest valid slot in that memory, without copying.
+ * It reads the same slot as `Record::read()` and writes the same slots as `Record::write_next()`.
+ * @tparam Record The `jjrecord` type.
+ * @note `payload()` is only valid while the memory it points to is unchanged.
+ */
+template <typename Record>
+class jjrecord_view {
+	using Integrity = typename Record::integrity_t;
+	using Seq = typename Record::seq_t;
+public:
+	using slot_t = typename Record::slot_t;
+
+	jjrecord_view() noexcept : slot{0, 0} {}
+	jjrecord_view(slot_t slot) noexcept : slot{slot} {}
+
+	/**
+	 * @return A pointer to the payload of the slot found by the last read, with size `Record::payload_size` bytes, or `nullptr` if none was found.
+	 */
+	const uint8_t* payload() const noexcept {
+		return in != nullptr? in + Record::header_size : nullptr;
+	}
+	/**
+	 * The current slot position.
+	 */
+	slot_t current_slot() const noexcept {
+		return slot;
+	}
+
+	/**
+	 * Find the record in memory holding all its slots, validated at once with `Record::validate_all()`, with the same rules as `Record::read()`.
+	 * @param slots The memory holding the slots, with slot `i` at `slots + i * Record::size`.
+	 * @return true if a valid record was found, false otherwise.
+	 */
+	bool read(const uint8_t* slots) noexcept {
+		bool valid[Record::redundancy];
+		Record::validate_all(slots, valid);
+		Seq seqnums[Record::redundancy];
+		for(size_t i=0; i<Record::redundancy; ++i) {
+			Record::parse_header(slots + i * Record::size, seqnums[i]);
+		}
+		const auto newest = Record::newest_candidate(valid, seqnums);
+		if(newest == Record::redundancy) {
+			in = nullptr;
+			return false;
+		}
+		in = slots + newest * Record::size;
+		slot = {static_cast<decltype(slot.index)>(newest), seqnums[newest]};
+		return true;
+	}
+	/**
+	 * Read the record from storage into a buffer, with the same rules as `Record::read_newest_first()`: slot headers are read first, then only full slots from the newest candidate down.
+	 * @param read_fn The function used to read the start of a slot from storage, with signature `bool read_fn(Index slot_index, uint8_t* out, size_t size)`, called with `size` set to `Record::header_size` or to the full slot size.
+	 * @param buffer The buffer receiving the slot, of `Record::size` bytes, which `payload()` points into.
+	 * @return true if a valid record was found and read, false otherwise.
+	 */
+	template <typename ReadFn>
+	bool read(ReadFn&& read_fn, uint8_t* buffer) {
+		in = nullptr;
+		Seq seqnums[Record::redundancy];
+		bool candidates[Record::redundancy];
+		for(size_t i=0; i<Record::redundancy; ++i) {
+			if(!read_fn(static_cast<decltype(slot.index)>(i), buffer, Record::header_size)) {
+				return false;
+			}
+			candidates[i] = Record::parse_header(buffer, seqnums[i]);
+		}
+		for(;;) {
+			const auto newest = Record::newest_candidate(candidates, seqnums);
+			if(newest == Record::redundancy) {
+				return false;
+			}
+			const auto index = static_cast<decltype(slot.index)>(newest);
+			if(!read_fn(index, buffer, Record::size)) {
+				return false;
+			}
+			Seq seqnum;
+			if(check(buffer, seqnum)) {
+				in = buffer;
+				slot = {index, seqnum};
+				return true;
+			}
+			candidates[newest] = false;
+		}
+	}
+
+	/**
+	 * Advance to the next slot and seal a slot prepared in a buffer, whose payload was written at `buffer + Record::header_size`.
+	 * @param buffer The slot buffer, of `Record::size` bytes, such as the next slot itself in byte-addressable memory.
+	 * @return The slot to write the buffer to.
+	 */
+	slot_t seal_next(uint8_t* buffer) noexcept {
+		slot = slot.next();
+		Record::seal_slot(buffer, slot.sequence_number);
+		return slot;
+	}
+private:
+	static bool check(const uint8_t* p, Seq& seqnum) noexcept {
+		return Integrity::verify(p, Record::size) && Record::parse_header(p, seqnum);
+	}
+
+	const uint8_t* in = nullptr;
+	slot_t slot;
+};
+
+/**
+ * A batch of slot reads of a `jjrecord`, for storage where reads can be issued together and complete in any order, such as files read with a thread pool or asynchronous I/O.
+ *
+ * The batch holds one read request per slot, each into its own buffer. The caller's backend services the requests, then calls `complete()` for each of them, possibly from different threads; each slot is validated as soon as its read completes.
+ * Once `done()`, `finish()` selects the newest valid slot with the same rules as `Record::read()`, whatever the completion order.
+ * @tparam Record The `jjrecord` type.
+ * @note This takes `Record::total_size` bytes of memory for the slot buffers.
+ */
+template <typename Record>
+class jjrecord_batch {
+	using Seq = typename Record::seq_t;
+	using Index = decltype(Record::slot_t::index);
+public:
+	/**
+	 * A read request.
+	 */
+	struct request_t {
+		/**
+		 * The slot to read.
+		 */
+		Index slot_index;
+		/**
+		 * The offset of the slot in the storage of the record, in bytes.
+		 */
+		size_t offset;
+		/**
+		 * The number of bytes to read.
+		 */
+		size_t size;
+		/**
+		 * The buffer receiving the bytes.
+		 */
+		uint8_t* out;
+	};
+
+	jjrecord_batch() noexcept {
+		for(size_t i=0; i<Record::redundancy; ++i) {
+			requests[i] = {static_cast<Index>(i), i * Record::size, Record::size, buffers[i]};
+		}
+		reset();
+	}
+	jjrecord_batch(const jjrecord_batch&) = delete;
+	jjrecord_batch& operator=(const jjrecord_batch&) = delete;
+
+	/**
+	 * Prepare the batch for a new read.
+	 */
+	void reset() noexcept {
+		std::fill_n(states, Record::redundancy, pending);
+		__atomic_store_n(&remaining, Record::redundancy, __ATOMIC_RELEASE);
+	}
+
+	/**
+	 * @return The read requests, one per slot.
+	 */
+	const request_t* data() const noexcept {
+		return requests;
+	}
+	/**
+	 * @return The number of read requests.
+	 */
+	static constexpr size_t size() noexcept {
+		return Record::redundancy;
+	}
+
+	/**
+	 * Complete a read request, validating the slot if it was read.
+	 * @param request The index of the request in `data()`.
+	 * @param success true if the bytes were read.
+	 * @note Requests can be completed concurrently from different threads, each exactly once per read.
+	 */
+	void complete(size_t request, bool success) noexcept {
+		auto state = failed;
+		if(success) {
+			state = invalid;
+			if(Record::integrity_t::verify(buffers[request], Record::size) && Record::parse_header(buffers[request], seqnums[request])) {
+				state = valid;
+			}
+		}
+		states[request] = state;
+		__atomic_sub_fetch(&remaining, 1, __ATOMIC_ACQ_REL);
+	}
+	/**
+	 * @return true if all requests have completed.
+	 */
+	bool done() const noexcept {
+		return __atomic_load_n(&remaining, __ATOMIC_ACQUIRE) == 0;
+	}
+
+	/**
+	 * Load the newest valid slot into a record, once all requests have completed.
+	 * @return true if a valid record was found and read, false if none was found, a read failed, or the batch is not done.
+	 */
+	bool finish(Record& record) noexcept {
+		if(!done()) {
+			return false;
+		}
+		bool candidates[Record::redundancy];
+		for(size_t i=0; i<Record::redundancy; ++i) {
+			if(states[i] == failed) {
+				return false;
+			}
+			candidates[i] = states[i] == valid;
+		}
+		const auto newest = Record::newest_candidate(candidates, seqnums);
+		if(newest == Record::redundancy) {
+			return false;
+		}
+		record.slot = {static_cast<Index>(newest), seqnums[newest]};
+		std::copy_n(buffers[newest] + Record::header_size, Record::payload_size, record.payload());
+		return true;
+	}
+private:
+	enum state_t : uint8_t {
+		pending,
+		failed,
+		invalid,
+		valid,
+	};
+
+	request_t requests[Record::redundancy];
+	uint8_t buffers[Record::redundancy][Record::size];
+	Seq seqnums[Record::redundancy];
+	state_t states[Record::redundancy];
+	size_t remaining;
+};
@@ -1,6 +1,9 @@
 #include "../ext/doctest.h"
 #include "jjrecord.hpp"
+#include <chrono>
 #include <random>
+#include <thread>
+#include <vector>
 
 TEST_SUITE_BEGIN("jjrecord");
 
@@ -27,6 +30,247 @@ TEST_CASE("jjrecord_crc16") {
 	}
 }
 
+TEST_CASE("[jjrecord][crc16] table and sliced versions match the bitwise reference") {
+	constexpr uint8_t check[] = {'1','2','3','4','5','6','7','8','9'};
+	static_assert(jjrecord_crc16_table::compute(check, sizeof(check)) == 0x29B1, "constexpr table CRC");
+	static_assert(jjrecord_crc16_slice4::compute(check, sizeof(check)) == 0x29B1, "constexpr slicing-by-4 CRC");
+	static_assert(jjrecord_crc16_slice8::compute(check, sizeof(check)) == 0x29B1, "constexpr slicing-by-8 CRC");
+
+	std::mt19937 rng(0x1021);
+	std::vector<uint8_t> data(300);
+	for(auto& b : data) {
+		b = static_cast<uint8_t>(rng());
+	}
+	for(size_t offset=0; offset<8; ++offset) {
+		for(size_t size=0; size+offset<=data.size(); size+=(size < 40? 1 : 37)) {
+			const auto init = static_cast<uint16_t>(rng());
+			const auto expected = jjrecord_crc16_bitwise::compute(data.data() + offset, size, init);
+			CHECK(jjrecord_crc16_table::compute(data.data() + offset, size, init) == expected);
+			CHECK(jjrecord_crc16_slice4::compute(data.data() + offset, size, init) == expected);
+			CHECK(jjrecord_crc16_slice8::compute(data.data() + offset, size, init) == expected);
+		}
+	}
+}
+
+TEST_CASE("[jjrecord][crc16] carry-less multiplication version matches the bitwise reference") {
+	const uint8_t check[] = {'1','2','3','4','5','6','7','8','9'};
+	CHECK(jjrecord_crc16_clmul::compute(check, sizeof(check)) == 0x29B1);
+	std::vector<uint8_t> ones(200, 0xFF);
+	CHECK(jjrecord_crc16_clmul::compute(ones.data(), 7) == 0xC360);
+	CHECK(jjrecord_crc16_clmul::compute(ones.data(), ones.size()) == jjrecord_crc16(ones.data(), ones.size()));
+
+	// Random lengths, alignments and initial values, covering the 4-way and single block folds and the tails
+	std::mt19937 rng(0xC1C1);
+	std::vector<uint8_t> data(4096 + 16);
+	for(auto& b : data) {
+		b = static_cast<uint8_t>(rng());
+	}
+	for(size_t n=0; n<2000; ++n) {
+		const size_t offset = rng() % 16;
+		const size_t size = (n < 300)? n : rng() % 4096;
+		const auto init = static_cast<uint16_t>(rng());
+		const auto expected = jjrecord_crc16(data.data() + offset, size, init);
+		CHECK(jjrecord_crc16_clmul::compute(data.data() + offset, size, init) == expected);
+	}
+#if defined(__x86_64__) || defined(__i386__)
+	// The kernel itself works from 16 bytes
+	if(__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3")) {
+		for(size_t size=16; size<64; ++size) {
+			CHECK(jjrecord_crc16_clmul_(data.data() + 3, size, 0x1234) == jjrecord_crc16(data.data() + 3, size, 0x1234));
+		}
+	}
+#endif
+}
+
+template <size_t Lanes>
+static void jjrecord_test_crc16_multi(std::mt19937& rng) {
+	std::vector<uint8_t> data(Lanes * 300);
+	for(auto& b : data) {
+		b = static_cast<uint8_t>(rng());
+	}
+	for(size_t size=0; size<=300; size+=(size < 20? 1 : 37)) {
+		const uint8_t* buffers[Lanes];
+		uint16_t crcs[Lanes];
+		for(size_t l=0; l<Lanes; ++l) {
+			buffers[l] = data.data() + l * 300;
+			crcs[l] = static_cast<uint16_t>(l == 0? 0xFFFF : rng());
+		}
+		uint16_t expected[Lanes];
+		for(size_t l=0; l<Lanes; ++l) {
+			expected[l] = jjrecord_crc16(buffers[l], size, crcs[l]);
+		}
+		jjrecord_crc16_multi<Lanes>(buffers, size, crcs);
+		for(size_t l=0; l<Lanes; ++l) {
+			CHECK(crcs[l] == expected[l]);
+		}
+	}
+}
+
+TEST_CASE("[jjrecord][crc16] multi-buffer version matches the bitwise reference") {
+	std::mt19937 rng(50);
+	jjrecord_test_crc16_multi<1>(rng);
+	jjrecord_test_crc16_multi<2>(rng);
+	jjrecord_test_crc16_multi<3>(rng);
+	jjrecord_test_crc16_multi<4>(rng);
+	jjrecord_test_crc16_multi<8>(rng);
+}
+
+TEST_CASE("[jjrecord][crc16] records are interchangeable between CRC implementations") {
+	using bitwise_t = jjrecord<0x12, 64, 2, jjrecord_check_crc16<jjrecord_crc16_bitwise>>;
+	using clmul_t = jjrecord<0x12, 64, 2, jjrecord_check_crc16<jjrecord_crc16_clmul>>;
+	bitwise_t a{{0, 5}};
+	for(size_t i=0; i<bitwise_t::payload_size; ++i) {
+		a.payload()[i] = static_cast<uint8_t>(i * 7);
+	}
+	clmul_t b;
+	CHECK(b.read_slot(0, a.write_slot(), false) == true);
+	CHECK(b.current_slot().sequence_number == 5);
+	CHECK(std::equal(a.payload(), a.payload() + bitwise_t::payload_size, b.payload()));
+}
+
+TEST_CASE("[jjrecord][integrity] crc32c matches the reference") {
+	constexpr uint8_t check[] = {'1','2','3','4','5','6','7','8','9'};
+	static_assert(jjrecord_crc32c(check, sizeof(check)) == 0xE3069283, "constexpr CRC-32C");
+	CHECK(jjrecord_check_crc32c::compute(check, sizeof(check)) == 0xE3069283);
+	CHECK(jjrecord_crc32c(check + 4, 5, jjrecord_crc32c(check, 4)) == 0xE3069283);
+
+	std::mt19937 rng(0x82F6);
+	std::vector<uint8_t> data(300);
+	for(auto& b : data) {
+		b = static_cast<uint8_t>(rng());
+	}
+	for(size_t offset=0; offset<8; ++offset) {
+		for(size_t size=0; size+offset<=data.size(); size+=(size < 40? 1 : 29)) {
+			CHECK(jjrecord_check_crc32c::compute(data.data() + offset, size) == jjrecord_crc32c(data.data() + offset, size));
+		}
+	}
+}
+
+template <typename Integrity>
+static void jjrecord_test_integrity() {
+	using record_t = jjrecord<0x34, 40, 3, Integrity>;
+	uint8_t memory[3][40] = {};
+	record_t writer;
+	for(uint8_t i=0; i<4; ++i) {
+		std::fill_n(writer.payload(), record_t::payload_size, i);
+		CHECK(writer.write_next([&](uint8_t slot, const uint8_t* data, size_t size) {
+			std::copy_n(data, size, memory[slot]);
+			return true;
+		}));
+	}
+	const auto reader = [&](size_t slot, uint8_t* out, size_t size) {
+		std::copy_n(memory[slot], size, out);
+		return true;
+	};
+	record_t record;
+	CHECK(record.read(reader) == true);
+	CHECK(record.current_slot().sequence_number == 4);
+	CHECK(record.payload()[record_t::payload_size - 1] == 3);
+	CHECK(memory[1][Integrity::size] == 0x34);
+	CHECK(memory[1][Integrity::size + 1] == 4);
+
+	// Corrupt the newest slot
+	memory[1][record_t::header_size + 5] ^= 0x10;
+	record_t fallback;
+	CHECK(fallback.read(reader) == true);
+	if(Integrity::size > 0) {
+		CHECK(fallback.current_slot().sequence_number == 3);
+		CHECK(fallback.payload()[0] == 2);
+	} else {
+		CHECK(fallback.current_slot().sequence_number == 4);
+	}
+}
+
+TEST_CASE("[jjrecord][integrity] header size follows the integrity policy") {
+	static_assert(jjrecord<1, 32, 2>::header_size == jjrecord_header_size, "default header size");
+	static_assert(jjrecord<1, 32, 2, jjrecord_check_crc32c>::header_size == 6, "CRC-32C header size");
+	static_assert(jjrecord<1, 32, 2, jjrecord_check_none>::header_size == 2, "unchecked header size");
+	static_assert(jjrecord<1, 32, 2, jjrecord_check_none>::payload_size == 30, "unchecked payload size");
+	jjrecord_test_integrity<jjrecord_check_crc16<>>();
+	jjrecord_test_integrity<jjrecord_check_crc16<jjrecord_crc16_bitwise>>();
+	jjrecord_test_integrity<jjrecord_check_crc32c>();
+	jjrecord_test_integrity<jjrecord_check_none>();
+}
+
+template <typename Crc16>
+static double jjrecord_bench_crc16(const std::vector<uint8_t>& data, size_t size) {
+	const size_t rounds = (size_t(64) << 20) / size; // 64 MB per run
+	uint16_t crc = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for(size_t r=0; r<rounds; ++r) {
+		crc ^= Crc16::compute(data.data(), size, static_cast<uint16_t>(r));
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	CHECK(crc != 0x10000); // Keep the result alive
+	return double(rounds * size) / (1 << 20) / elapsed.count();
+}
+
+TEST_CASE("[jjrecord][crc16][bench] CRC-16 throughput by implementation and buffer size" * doctest::skip()) {
+	std::vector<uint8_t> data(64 << 10);
+	for(size_t i=0; i<data.size(); ++i) {
+		data[i] = static_cast<uint8_t>(i * 131);
+	}
+	for(size_t size=32; size<=data.size(); size*=2) {
+		MESSAGE(size << " B: bitwise " << jjrecord_bench_crc16<jjrecord_crc16_bitwise>(data, size)
+			<< " MB/s, table " << jjrecord_bench_crc16<jjrecord_crc16_table>(data, size)
+			<< " MB/s, slice4 " << jjrecord_bench_crc16<jjrecord_crc16_slice4>(data, size)
+			<< " MB/s, slice8 " << jjrecord_bench_crc16<jjrecord_crc16_slice8>(data, size)
+			<< " MB/s, clmul " << jjrecord_bench_crc16<jjrecord_crc16_clmul>(data, size) << " MB/s");
+	}
+}
+
+template <size_t Lanes>
+static double jjrecord_bench_crc16_multi(const std::vector<uint8_t>& data, size_t size, size_t count) {
+	const size_t rounds = (size_t(64) << 20) / (size * count);
+	uint16_t crc = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for(size_t r=0; r<rounds; ++r) {
+		for(size_t i=0; i<count; i+=Lanes) {
+			const uint8_t* buffers[Lanes];
+			for(size_t l=0; l<Lanes; ++l) {
+				buffers[l] = data.data() + (i + l) * size;
+			}
+			uint16_t crcs[Lanes];
+			std::fill_n(crcs, Lanes, static_cast<uint16_t>(r));
+			jjrecord_crc16_multi<Lanes>(buffers, size, crcs);
+			crc ^= crcs[0];
+		}
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	CHECK(crc != 0x10000); // Keep the result alive
+	return double(rounds * size * count) / (1 << 20) / elapsed.count();
+}
+
+template <typename Crc16>
+static double jjrecord_bench_crc16_sequential(const std::vector<uint8_t>& data, size_t size, size_t count) {
+	const size_t rounds = (size_t(64) << 20) / (size * count);
+	uint16_t crc = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for(size_t r=0; r<rounds; ++r) {
+		for(size_t i=0; i<count; ++i) {
+			crc ^= Crc16::compute(data.data() + i * size, size, static_cast<uint16_t>(r));
+		}
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	CHECK(crc != 0x10000); // Keep the result alive
+	return double(rounds * size * count) / (1 << 20) / elapsed.count();
+}
+
+TEST_CASE("[jjrecord][crc16][bench] CRC-16 of 8 slots, one after the other or interleaved" * doctest::skip()) {
+	std::vector<uint8_t> data(8 * (16 << 10));
+	for(size_t i=0; i<data.size(); ++i) {
+		data[i] = static_cast<uint8_t>(i * 131);
+	}
+	for(size_t size=32; size<=(16 << 10); size*=2) {
+		MESSAGE("8 x " << size << " B: bitwise " << jjrecord_bench_crc16_sequential<jjrecord_crc16_bitwise>(data, size, 8)
+			<< " MB/s, slice8 " << jjrecord_bench_crc16_sequential<jjrecord_crc16_slice8>(data, size, 8)
+			<< " MB/s, multi2 " << jjrecord_bench_crc16_multi<2>(data, size, 8)
+			<< " MB/s, multi4 " << jjrecord_bench_crc16_multi<4>(data, size, 8)
+			<< " MB/s, multi8 " << jjrecord_bench_crc16_multi<8>(data, size, 8)
+			<< " MB/s, clmul " << jjrecord_bench_crc16_sequential<jjrecord_crc16_clmul>(data, size, 8) << " MB/s");
+	}
+}
+
 template <typename RecordType>
 struct jjrecord_tester_t {
 	uint8_t memory[RecordType::redundancy][RecordType::size];
@@ -613,4 +857,647 @@ TEST_CASE("[jjrecord] rejects slot whose seqnum is behind across wrap") {
 	CHECK(payload[1] == 0);
 }
 
+TEST_CASE("[jjrecord][newest_first] reads headers, then only the newest slot") {
+	using jjrecord = jjrecord<0x12, 256, 8>;
+	jjrecord_tester_t<jjrecord> tester{};
+	for(uint8_t i=0; i<8; ++i) {
+		tester.setup(i, static_cast<uint8_t>(250 + i)); // wraps at slot 6
+	}
+	size_t bytes = 0;
+	const auto reader = [&](size_t slot_index, uint8_t* out, size_t size) {
+		bytes += size;
+		std::copy_n(tester.memory[slot_index], size, out);
+		return true;
+	};
+	jjrecord record;
+	CHECK(record.read_newest_first(reader) == true);
+	CHECK(record.current_slot().index == 7);
+	CHECK(record.current_slot().sequence_number == 1);
+	CHECK(record.payload()[0] == 7);
+	CHECK(bytes == 8 * jjrecord::header_size + jjrecord::size);
+
+	// A corrupted newest slot falls back to the previous one
+	tester.memory[7][100] ^= 0x04;
+	bytes = 0;
+	CHECK(record.read_newest_first(reader) == true);
+	CHECK(record.current_slot().index == 6);
+	CHECK(record.current_slot().sequence_number == 0);
+	CHECK(bytes == 8 * jjrecord::header_size + 2 * jjrecord::size);
+}
+
+TEST_CASE("[jjrecord][newest_first] applies the same window rules as the full scan") {
+	using jjrecord = jjrecord<0xEF, 128, 3>;
+	jjrecord_tester_t<jjrecord> tester{};
+	const auto reader = [&](size_t slot_index, uint8_t* out, size_t size) {
+		std::copy_n(tester.memory[slot_index], size, out);
+		return true;
+	};
+	jjrecord record;
+	CHECK(record.read_newest_first(reader) == false);
+
+	tester.setup(0, 0);
+	tester.setup(1, 10); // Jump larger than redundancy window
+	tester.setup(2, 1);
+	CHECK(record.read_newest_first(reader) == true);
+	CHECK(record.current_slot().index == 2);
+
+	tester.setup(0, 0);
+	tester.setup(1, 255); // Behind across wrap
+	tester.setup(2, 254);
+	CHECK(record.read_newest_first(reader) == true);
+	CHECK(record.current_slot().index == 0);
+
+	for(auto& slot : tester.memory) {
+		slot[0] ^= 0x01;
+	}
+	CHECK(record.read_newest_first(reader) == false);
+	CHECK(record.read_newest_first([](size_t, uint8_t*, size_t) { return false; }) == false);
+}
+
+TEST_CASE("[jjrecord][newest_first] matches the full scan on rotating writes") {
+	using jjrecord = jjrecord<0x21, 48, 5>;
+	std::mt19937 rng(0x40);
+	for(size_t run=0; run<200; ++run) {
+		uint8_t memory[5][48] = {};
+		jjrecord writer{{static_cast<uint8_t>(rng() % 5), static_cast<uint8_t>(rng())}};
+		const auto writes = rng() % 12;
+		for(size_t w=0; w<writes; ++w) {
+			std::fill_n(writer.payload(), jjrecord::payload_size, static_cast<uint8_t>(w));
+			writer.write_next([&](uint8_t slot, const uint8_t* data, size_t size) {
+				std::copy_n(data, size, memory[slot]);
+				return true;
+			});
+		}
+		if(rng() % 2) {
+			memory[rng() % 5][rng() % 48] ^= 0x80;
+		}
+		const auto reader = [&](size_t slot_index, uint8_t* out, size_t size) {
+			std::copy_n(memory[slot_index], size, out);
+			return true;
+		};
+		jjrecord full, fast;
+		const auto found = full.read(reader);
+		CHECK(fast.read_newest_first(reader) == found);
+		if(found) {
+			CHECK(fast.current_slot().index == full.current_slot().index);
+			CHECK(fast.current_slot().sequence_number == full.current_slot().sequence_number);
+			CHECK(std::equal(full.payload(), full.payload() + jjrecord::payload_size, fast.payload()));
+		}
+	}
+}
+
+template <typename RecordType>
+struct jjrecord_flash_t {
+	std::vector<uint8_t> memory = std::vector<uint8_t>(RecordType::total_size, 0xFF);
+	size_t header_reads = 0;
+	size_t slot_reads = 0;
+
+	bool write(size_t slot_index, const uint8_t* data, size_t size) {
+		std::copy_n(data, size, memory.data() + slot_index * RecordType::size);
+		return true;
+	}
+	bool read(size_t slot_index, uint8_t* out, size_t size) {
+		++(size == RecordType::size? slot_reads : header_reads);
+		std::copy_n(memory.data() + slot_index * RecordType::size, size, out);
+		return true;
+	}
+	uint8_t* slot(size_t slot_index) {
+		return memory.data() + slot_index * RecordType::size;
+	}
+};
+
+TEST_CASE("[jjrecord][wide] wide sequence numbers and thousands of slots") {
+	using jjrecord = jjrecord<0x5A, 32, 1000, jjrecord_check_crc16<>, uint32_t, uint16_t>;
+	static_assert(jjrecord::header_size == 7, "32-bit sequence numbers take 4 header bytes");
+	jjrecord_flash_t<jjrecord> flash;
+	const auto write = [&](uint16_t slot_index, const uint8_t* data, size_t size) { return flash.write(slot_index, data, size); };
+	const auto read = [&](uint16_t slot_index, uint8_t* out, size_t size) { return flash.read(slot_index, out, size); };
+
+	jjrecord empty;
+	CHECK(empty.read_bisect(read) == false);
+
+	jjrecord writer;
+	uint32_t writes = 0;
+	for(const uint32_t target : {1u, 2u, 500u, 998u, 999u, 1000u, 1001u, 1500u, 2999u, 3000u}) {
+		for(; writes<target; ++writes) {
+			std::copy_n(reinterpret_cast<const uint8_t*>(&writes), sizeof(writes), writer.payload());
+			REQUIRE(writer.write_next(write));
+		}
+		flash.header_reads = flash.slot_reads = 0;
+		jjrecord record;
+		CHECK(record.read_bisect(read) == true);
+		CHECK(record.current_slot().index == writer.current_slot().index);
+		CHECK(record.current_slot().sequence_number == target);
+		CHECK(flash.header_reads <= 13);
+		CHECK(flash.slot_reads == 1);
+
+		jjrecord full;
+		CHECK(full.read(read) == true);
+		CHECK(full.current_slot().sequence_number == target);
+	}
+}
+
+TEST_CASE("[jjrecord][wide] redundancy up to half the sequence number range") {
+	// 128 slots with 8-bit sequence numbers is the largest record where a newer slot cannot look older
+	using jjrecord = jjrecord<0x5A, 16, 128>;
+	jjrecord_flash_t<jjrecord> flash;
+	const auto write = [&](uint8_t slot_index, const uint8_t* data, size_t size) { return flash.write(slot_index, data, size); };
+	const auto read = [&](uint8_t slot_index, uint8_t* out, size_t size) { return flash.read(slot_index, out, size); };
+
+	jjrecord writer;
+	size_t writes = 0;
+	for(const size_t target : {size_t(127), size_t(128), size_t(148), size_t(255), size_t(256), size_t(700)}) {
+		for(; writes<target; ++writes) {
+			writer.payload()[0] = static_cast<uint8_t>(writes);
+			REQUIRE(writer.write_next(write));
+		}
+		const auto newest = writer.current_slot();
+		CHECK(newest.sequence_number == static_cast<uint8_t>(target));
+		jjrecord full, newest_first, bisect;
+		CHECK(full.read(read) == true);
+		CHECK(full.current_slot().sequence_number == newest.sequence_number);
+		CHECK(full.current_slot().index == newest.index);
+		CHECK(newest_first.read_newest_first(read) == true);
+		CHECK(newest_first.current_slot().sequence_number == newest.sequence_number);
+		CHECK(bisect.read_bisect(read) == true);
+		CHECK(bisect.current_slot().sequence_number == newest.sequence_number);
+		CHECK(bisect.payload()[0] == static_cast<uint8_t>(target - 1));
+	}
+}
+
+TEST_CASE("[jjrecord][wide] bisect recovers from torn writes") {
+	using jjrecord = jjrecord<0x5A, 32, 300, jjrecord_check_crc16<>, uint16_t>;
+	jjrecord_flash_t<jjrecord> flash;
+	const auto write = [&](uint16_t slot_index, const uint8_t* data, size_t size) { return flash.write(slot_index, data, size); };
+	const auto read = [&](uint16_t slot_index, uint8_t* out, size_t size) { return flash.read(slot_index, out, size); };
+
+	// Sequence numbers wrap around 16 bits while slot indices wrap around 300
+	jjrecord writer{{299, 65500}};
+	for(int i=0; i<450; ++i) {
+		REQUIRE(writer.write_next(write));
+	}
+	const auto newest = writer.current_slot();
+	CHECK(newest.index == 149);
+	CHECK(newest.sequence_number == 414);
+
+	jjrecord record;
+	CHECK(record.read_bisect(read) == true);
+	CHECK(record.current_slot().index == 149);
+
+	SUBCASE("torn payload") {
+		flash.slot(149)[20] ^= 0x01;
+		CHECK(record.read_bisect(read) == true);
+		CHECK(record.current_slot().index == 148);
+		CHECK(record.current_slot().sequence_number == 413);
+	}
+	SUBCASE("torn header") {
+		std::fill_n(flash.slot(149), jjrecord::header_size, 0xFF);
+		CHECK(record.read_bisect(read) == true);
+		CHECK(record.current_slot().index == 148);
+	}
+	SUBCASE("torn slot 0 right after wrap") {
+		jjrecord_flash_t<jjrecord> fresh;
+		jjrecord first;
+		for(int i=0; i<300; ++i) {
+			REQUIRE(first.write_next([&](uint16_t slot_index, const uint8_t* data, size_t size) { return fresh.write(slot_index, data, size); }));
+		}
+		CHECK(first.current_slot().index == 0);
+		fresh.slot(0)[20] ^= 0x01;
+		CHECK(record.read_bisect([&](uint16_t slot_index, uint8_t* out, size_t size) { return fresh.read(slot_index, out, size); }) == true);
+		CHECK(record.current_slot().index == 299);
+		CHECK(record.current_slot().sequence_number == 299);
+	}
+	SUBCASE("storage failure") {
+		CHECK(record.read_bisect([](uint16_t, uint8_t*, size_t) { return false; }) == false);
+	}
+}
+
+template <typename RecordType>
+struct jjrecord_eeprom_t : jjrecord_flash_t<RecordType> {
+	size_t fail_after = SIZE_MAX;
+
+	bool write_range(size_t slot_index, size_t offset, const uint8_t* data, size_t size) {
+		if(fail_after == 0) {
+			return false;
+		}
+		--fail_after;
+		REQUIRE(offset + size <= RecordType::size);
+		std::copy_n(data, size, this->slot(slot_index) + offset);
+		return true;
+	}
+};
+
+TEST_CASE("[jjrecord][delta] only changed bytes are written") {
+	using jjrecord = jjrecord<0x5A, 64, 2>;
+	jjrecord_eeprom_t<jjrecord> eeprom;
+	const auto write_range = [&](uint8_t slot_index, size_t offset, const uint8_t* data, size_t size) { return eeprom.write_range(slot_index, offset, data, size); };
+	const auto read = [&](uint8_t slot_index, uint8_t* out, size_t size) { return eeprom.read(slot_index, out, size); };
+
+	jjrecord record;
+	jjrecord_delta<jjrecord> delta;
+	std::fill_n(record.payload(), jjrecord::payload_size, 0);
+	// Unknown slot images are written in full
+	CHECK(delta.write_next(record, write_range) == true);
+	CHECK(delta.write_next(record, write_range) == true);
+	CHECK(delta.bytes_written() == 2 * jjrecord::size);
+	CHECK(delta.ranges_written() == 2);
+
+	delta.reset_stats();
+	record.payload()[10] = 1;
+	CHECK(delta.write_next(record, write_range) == true);
+	// The changed payload byte, then at most the whole header
+	CHECK(delta.ranges_written() == 2);
+	CHECK(delta.bytes_written() <= 1 + jjrecord::header_size);
+	jjrecord check;
+	CHECK(check.read(read) == true);
+	CHECK(check.current_slot().sequence_number == 3);
+	CHECK(std::equal(check.payload(), check.payload() + jjrecord::payload_size, record.payload()));
+
+	// Close changes are merged with max_gap
+	delta.reset_stats();
+	record.payload()[20] = 1;
+	record.payload()[23] = 1;
+	CHECK(delta.write_next(record, write_range) == true);
+	CHECK(delta.ranges_written() == 4);
+	delta.reset_stats();
+	record.payload()[30] = 1;
+	record.payload()[33] = 1;
+	CHECK(delta.write_next(record, write_range, 2) == true);
+	// The target slot was written two records ago, so it also lacks bytes 20 and 23
+	CHECK(delta.ranges_written() == 3);
+	CHECK(check.read(read) == true);
+	CHECK(std::equal(check.payload(), check.payload() + jjrecord::payload_size, record.payload()));
+
+	// Once both slots hold the payload, an unchanged payload only rewrites the header
+	CHECK(delta.write_next(record, write_range) == true);
+	delta.reset_stats();
+	CHECK(delta.write_next(record, write_range) == true);
+	CHECK(delta.ranges_written() == 1);
+	CHECK(delta.bytes_written() <= jjrecord::header_size);
+}
+
+TEST_CASE("[jjrecord][delta] images are learned from reads and forgotten on failures") {
+	using jjrecord = jjrecord<0x5A, 64, 3>;
+	jjrecord_eeprom_t<jjrecord> eeprom;
+	const auto write_range = [&](uint8_t slot_index, size_t offset, const uint8_t* data, size_t size) { return eeprom.write_range(slot_index, offset, data, size); };
+	const auto read = [&](uint8_t slot_index, uint8_t* out, size_t size) { return eeprom.read(slot_index, out, size); };
+	{
+		jjrecord writer;
+		std::fill_n(writer.payload(), jjrecord::payload_size, 0x33);
+		for(int i=0; i<4; ++i) {
+			REQUIRE(writer.write_next([&](uint8_t slot_index, const uint8_t* data, size_t size) { return eeprom.write(slot_index, data, size); }));
+		}
+	}
+
+	jjrecord record;
+	jjrecord_delta<jjrecord> delta;
+	CHECK(delta.read(record, read) == true);
+	CHECK(record.current_slot().sequence_number == 4);
+	record.payload()[0] = 0x34;
+	CHECK(delta.write_next(record, write_range) == true);
+	CHECK(delta.bytes_written() <= 1 + jjrecord::header_size);
+
+	// A failed write falls back to a full write of that slot next time
+	record.payload()[1] = 0x34;
+	eeprom.fail_after = 1;
+	CHECK(delta.write_next(record, write_range) == false);
+	eeprom.fail_after = SIZE_MAX;
+	CHECK(delta.write_next(record, write_range) == true); // Slot 2, still known
+	CHECK(delta.write_next(record, write_range) == true); // Slot 0
+	delta.reset_stats();
+	CHECK(delta.write_next(record, write_range) == true); // Slot 1, forgotten
+	CHECK(delta.bytes_written() == jjrecord::size);
+
+	delta.invalidate();
+	delta.reset_stats();
+	CHECK(delta.write_next(record, write_range) == true);
+	CHECK(delta.bytes_written() == jjrecord::size);
+
+	jjrecord check;
+	CHECK(check.read(read) == true);
+	CHECK(check.current_slot().index == record.current_slot().index);
+	CHECK(std::equal(check.payload(), check.payload() + jjrecord::payload_size, record.payload()));
+}
+
+TEST_CASE("[jjrecord][writebehind] updates are coalesced until quiet or overdue") {
+	using jjrecord = jjrecord<0x5A, 16, 2>;
+	jjrecord_flash_t<jjrecord> flash;
+	size_t writes = 0;
+	const auto write = [&](uint8_t slot_index, const uint8_t* data, size_t size) { ++writes; return flash.write(slot_index, data, size); };
+	const auto read = [&](uint8_t slot_index, uint8_t* out, size_t size) { return flash.read(slot_index, out, size); };
+
+	jjrecord record;
+	std::fill_n(record.payload(), jjrecord::payload_size, 0);
+	jjrecord_writebehind<jjrecord> writer(record, 500, 2000);
+	CHECK(writer.dirty() == false);
+	CHECK(writer.process(0, write) == true);
+	CHECK(writes == 0);
+
+	// A knob turned every 20 ms for one second, then left alone
+	uint32_t t = 1000;
+	for(uint16_t value=1; value<=50; ++value, t+=20) {
+		CHECK(writer.update(4, &value, sizeof(value), t) == true);
+		CHECK(writer.process(t, write) == true);
+	}
+	const uint16_t same = 50;
+	CHECK(writer.update(4, &same, sizeof(same), t) == false);
+	CHECK(writer.update(jjrecord::payload_size - 1, &same, sizeof(same), t) == false);
+	CHECK(writes == 0);
+	CHECK(writer.dirty() == true);
+	CHECK(writer.process(t + 499 - 20, write) == true);
+	CHECK(writes == 0);
+	CHECK(writer.process(t + 500 - 20, write) == true);
+	CHECK(writes == 1);
+	CHECK(writer.dirty() == false);
+	CHECK(writer.updates() == 50);
+	CHECK(writer.flushes() == 1);
+
+	jjrecord check;
+	CHECK(check.read(read) == true);
+	uint16_t value;
+	std::copy_n(check.payload() + 4, sizeof(value), reinterpret_cast<uint8_t*>(&value));
+	CHECK(value == 50);
+
+	// Continuous updates are written at least every max delay, across clock wraparound
+	writes = 0;
+	t = UINT32_MAX - 1000;
+	for(uint16_t i=0; i<500; ++i, t+=10) {
+		const uint16_t v = i;
+		writer.update(0, &v, sizeof(v), t);
+		CHECK(writer.process(t, write) == true);
+	}
+	CHECK(writes == 2);
+
+	// Failed writes are retried
+	const auto fail = [](uint8_t, const uint8_t*, size_t) { return false; };
+	writer.update(0, &same, sizeof(same), t);
+	CHECK(writer.process(t + 500, fail) == false);
+	CHECK(writer.dirty() == true);
+	CHECK(writer.flush_now(write) == true);
+	CHECK(writer.dirty() == false);
+	CHECK(writer.flush_now(fail) == true); // Nothing to write
+}
+
+TEST_CASE("[jjrecord][hint] a hinted read takes two slot reads") {
+	using jjrecord = jjrecord<0x5A, 32, 16>;
+	jjrecord_flash_t<jjrecord> flash;
+	const auto write = [&](uint8_t slot_index, const uint8_t* data, size_t size) { return flash.write(slot_index, data, size); };
+	const auto read = [&](uint8_t slot_index, uint8_t* out, size_t size) { return flash.read(slot_index, out, size); };
+
+	jjrecord writer;
+	jjrecord::slot_t hint = writer.current_slot();
+	for(uint8_t i=1; i<=40; ++i) {
+		writer.payload()[0] = i;
+		REQUIRE(writer.write_next(write));
+		hint = writer.current_slot();
+	}
+
+	// Up to date
+	flash.slot_reads = 0;
+	jjrecord record;
+	CHECK(record.read_hinted(read, hint) == true);
+	CHECK(flash.slot_reads == 2);
+	CHECK(record.current_slot().index == writer.current_slot().index);
+	CHECK(record.current_slot().sequence_number == 40);
+	CHECK(record.payload()[0] == 40);
+
+	// Writes happened after the hint was stored
+	const auto stale = hint;
+	for(uint8_t i=41; i<=43; ++i) {
+		writer.payload()[0] = i;
+		REQUIRE(writer.write_next(write));
+	}
+	flash.slot_reads = 0;
+	CHECK(record.read_hinted(read, stale) == true);
+	CHECK(flash.slot_reads == 5);
+	CHECK(record.current_slot().sequence_number == 43);
+	CHECK(record.payload()[0] == 43);
+
+	// The hinted slot was overwritten since, or the hint is garbage: full scan
+	flash.slot_reads = 0;
+	CHECK(record.read_hinted(read, {stale.index, static_cast<uint8_t>(stale.sequence_number - 16)}) == true);
+	CHECK(flash.slot_reads == 1 + jjrecord::redundancy);
+	CHECK(record.current_slot().sequence_number == 43);
+	CHECK(record.read_hinted(read, {200, 0}) == true);
+	CHECK(record.current_slot().sequence_number == 43);
+
+	// The hinted slot is corrupted: full scan
+	hint = writer.current_slot();
+	flash.slot(hint.index)[jjrecord::header_size] ^= 1;
+	CHECK(record.read_hinted(read, hint) == true);
+	CHECK(record.current_slot().sequence_number == 42);
+	CHECK(record.payload()[0] == 42);
+
+	// Storage failures are reported
+	CHECK(record.read_hinted([](uint8_t, uint8_t*, size_t) { return false; }, hint) == false);
+}
+
+TEST_CASE("[jjrecord][view] slots are validated in place") {
+	using jjrecord = jjrecord<0x5A, 64, 4>;
+	jjrecord_flash_t<jjrecord> flash;
+	const auto write = [&](uint8_t slot_index, const uint8_t* data, size_t size) { return flash.write(slot_index, data, size); };
+	const auto read = [&](uint8_t slot_index, uint8_t* out, size_t size) { return flash.read(slot_index, out, size); };
+
+	jjrecord_view<jjrecord> view;
+	CHECK(view.read(flash.memory.data()) == false);
+	CHECK(view.payload() == nullptr);
+
+	// Written in place, as in byte-addressable memory
+	for(uint8_t i=1; i<=6; ++i) {
+		uint8_t* next = flash.slot(view.current_slot().next().index);
+		next[jjrecord::header_size] = i;
+		CHECK(view.seal_next(next).index == (i % 4));
+	}
+	jjrecord record;
+	CHECK(record.read(read) == true);
+	CHECK(record.current_slot().sequence_number == 6);
+	CHECK(record.payload()[0] == 6);
+
+	jjrecord_view<jjrecord> mapped;
+	CHECK(mapped.read(flash.memory.data()) == true);
+	CHECK(mapped.payload() == flash.slot(2) + jjrecord::header_size);
+	CHECK(mapped.current_slot().index == 2);
+	CHECK(mapped.current_slot().sequence_number == 6);
+
+	// A torn newest slot
+	flash.slot(2)[jjrecord::size - 1] ^= 1;
+	CHECK(mapped.read(flash.memory.data()) == true);
+	CHECK(mapped.payload()[0] == 5);
+
+	// Through a read function, into a single buffer
+	uint8_t buffer[jjrecord::size];
+	jjrecord_view<jjrecord> buffered;
+	CHECK(buffered.read(read, buffer) == true);
+	CHECK(buffered.payload() == buffer + jjrecord::header_size);
+	CHECK(buffered.payload()[0] == 5);
+	CHECK(buffered.current_slot().index == 1);
+	CHECK(buffered.read([](uint8_t, uint8_t*, size_t) { return false; }, buffer) == false);
+
+	// Continue writing after a read, from a buffer
+	buffer[jjrecord::header_size] = 7;
+	const auto s = buffered.seal_next(buffer);
+	CHECK(write(s.index, buffer, jjrecord::size) == true);
+	CHECK(record.read(read) == true);
+	CHECK(record.current_slot().sequence_number == 6);
+	CHECK(record.payload()[0] == 7);
+}
+
+TEST_CASE("[jjrecord][view] finds the same slot as read on random contents") {
+	using jjrecord = jjrecord<0x5A, 16, 5>;
+	std::mt19937 rng(47);
+	for(int iter=0; iter<2000; ++iter) {
+		jjrecord_flash_t<jjrecord> flash;
+		for(size_t i=0; i<jjrecord::redundancy; ++i) {
+			if(rng() % 3 == 0) {
+				continue;
+			}
+			jjrecord writer({static_cast<uint8_t>(i), static_cast<uint8_t>(rng() % 8)});
+			writer.payload()[0] = static_cast<uint8_t>(rng());
+			const auto p = writer.write_slot();
+			std::copy_n(p, jjrecord::size, flash.slot(i));
+			if(rng() % 4 == 0) {
+				flash.slot(i)[rng() % jjrecord::size] ^= 0x10;
+			}
+		}
+		jjrecord record;
+		const bool found = record.read([&](uint8_t slot_index, uint8_t* out, size_t size) { return flash.read(slot_index, out, size); });
+		jjrecord_view<jjrecord> view;
+		REQUIRE(view.read(flash.memory.data()) == found);
+		if(found) {
+			CHECK(view.current_slot().index == record.current_slot().index);
+			CHECK(view.current_slot().sequence_number == record.current_slot().sequence_number);
+			CHECK(view.payload()[0] == record.payload()[0]);
+		}
+	}
+}
+
+TEST_CASE("[jjrecord][batch] completions in any order select the same slot as read") {
+	using jjrecord = jjrecord<0x5A, 16, 5>;
+	std::mt19937 rng(48);
+	jjrecord_batch<jjrecord> batch;
+	CHECK(batch.size() == jjrecord::redundancy);
+	for(int iter=0; iter<2000; ++iter) {
+		jjrecord_flash_t<jjrecord> flash;
+		for(size_t i=0; i<jjrecord::redundancy; ++i) {
+			if(rng() % 3 == 0) {
+				continue;
+			}
+			jjrecord writer({static_cast<uint8_t>(i), static_cast<uint8_t>(rng() % 8)});
+			writer.payload()[0] = static_cast<uint8_t>(rng());
+			std::copy_n(writer.write_slot(), jjrecord::size, flash.slot(i));
+			if(rng() % 4 == 0) {
+				flash.slot(i)[rng() % jjrecord::size] ^= 0x10;
+			}
+		}
+		jjrecord expected;
+		const bool found = expected.read([&](uint8_t slot_index, uint8_t* out, size_t size) { return flash.read(slot_index, out, size); });
+
+		batch.reset();
+		size_t order[jjrecord::redundancy];
+		for(size_t i=0; i<jjrecord::redundancy; ++i) {
+			order[i] = i;
+		}
+		std::shuffle(order, order + jjrecord::redundancy, rng);
+		jjrecord record;
+		for(const auto i : order) {
+			CHECK(batch.done() == false);
+			CHECK(batch.finish(record) == false);
+			const auto& r = batch.data()[i];
+			CHECK(r.slot_index == i);
+			std::copy_n(flash.memory.data() + r.offset, r.size, r.out);
+			batch.complete(i, true);
+		}
+		CHECK(batch.done() == true);
+		REQUIRE(batch.finish(record) == found);
+		if(found) {
+			CHECK(record.current_slot().index == expected.current_slot().index);
+			CHECK(record.current_slot().sequence_number == expected.current_slot().sequence_number);
+			CHECK(record.payload()[0] == expected.payload()[0]);
+		}
+	}
+}
+
+TEST_CASE("[jjrecord][batch] requests completed by concurrent threads") {
+	using jjrecord = jjrecord<0x5A, 4096, 8>;
+	jjrecord_flash_t<jjrecord> flash;
+	jjrecord writer;
+	for(uint8_t i=1; i<=11; ++i) {
+		writer.payload()[100] = i;
+		REQUIRE(writer.write_next([&](uint8_t slot_index, const uint8_t* data, size_t size) { return flash.write(slot_index, data, size); }));
+	}
+
+	jjrecord_batch<jjrecord> batch;
+	std::thread threads[4];
+	for(size_t t=0; t<4; ++t) {
+		threads[t] = std::thread([&, t]() {
+			for(size_t i=t; i<batch.size(); i+=4) {
+				const auto& r = batch.data()[i];
+				std::copy_n(flash.memory.data() + r.offset, r.size, r.out);
+				batch.complete(i, true);
+			}
+		});
+	}
+	while(!batch.done()) {
+		std::this_thread::yield();
+	}
+	for(auto& thread : threads) {
+		thread.join();
+	}
+	jjrecord record;
+	CHECK(batch.finish(record) == true);
+	CHECK(record.current_slot().index == 3);
+	CHECK(record.current_slot().sequence_number == 11);
+	CHECK(record.payload()[100] == 11);
+
+	// A failed read fails the batch, as with read()
+	batch.reset();
+	for(size_t i=0; i<batch.size(); ++i) {
+		batch.complete(i, i != 5);
+	}
+	CHECK(batch.finish(record) == false);
+}
+
+template <typename RecordType>
+static void jjrecord_test_read_all(uint32_t seed) {
+	std::mt19937 rng(seed);
+	for(int iter=0; iter<1000; ++iter) {
+		jjrecord_flash_t<RecordType> flash;
+		for(size_t i=0; i<RecordType::redundancy; ++i) {
+			if(rng() % 4 == 0) {
+				continue;
+			}
+			RecordType writer({static_cast<uint8_t>(i), static_cast<uint8_t>(rng() % 8)});
+			writer.payload()[0] = static_cast<uint8_t>(rng());
+			std::copy_n(writer.write_slot(), RecordType::size, flash.slot(i));
+			if(rng() % 4 == 0) {
+				flash.slot(i)[rng() % RecordType::size] ^= 0x10;
+			}
+		}
+		bool valid[RecordType::redundancy];
+		size_t expected_count = 0;
+		for(size_t i=0; i<RecordType::redundancy; ++i) {
+			RecordType single;
+			expected_count += single.read_slot(static_cast<uint8_t>(i), flash.slot(i), false);
+		}
+		CHECK(RecordType::validate_all(flash.memory.data(), valid) == expected_count);
+
+		RecordType expected;
+		const bool found = expected.read([&](uint8_t slot_index, uint8_t* out, size_t size) { return flash.read(slot_index, out, size); });
+		RecordType record;
+		REQUIRE(record.read_all(flash.memory.data()) == found);
+		if(found) {
+			CHECK(record.current_slot().index == expected.current_slot().index);
+			CHECK(record.current_slot().sequence_number == expected.current_slot().sequence_number);
+			CHECK(record.payload()[0] == expected.payload()[0]);
+		}
+	}
+}
+
+TEST_CASE("[jjrecord][bulk] validating all slots at once matches read") {
+	jjrecord_test_read_all<jjrecord<0x5A, 40, 9>>(501);
+	jjrecord_test_read_all<jjrecord<0x5A, 40, 9, jjrecord_check_crc16<jjrecord_crc16_slice8>>>(504);
+	jjrecord_test_read_all<jjrecord<0x5A, 16, 4>>(502);
+	jjrecord_test_read_all<jjrecord<0x5A, 40, 7, jjrecord_check_crc32c>>(503);
+}
+
 TEST_SUITE_END();
@@ -0,0 +1,454 @@
+#pragma once
+#include "jjrecord.hpp"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * A log-structured store of many small records of different types, sharing a region of flash blocks.
+ *
+ * Each write appends an entry to the active block, with the `jjrecord` header (CRC-16, type, sequence number) followed by a 16-bit payload length.
+ * An index in RAM maps each type to its latest entry; it is rebuilt by `mount()`, which scans the blocks from oldest to newest.
+ * When no free block is left for appending, the live entries of the oldest block are compacted into a fresh block, and the oldest block is erased.
+ * One block is always kept free for compaction, so interrupted compactions and torn writes leave the previous values readable; `mount()` finishes an interrupted compaction.
+ * Compaction only happens when it leaves room for the entry being written, so a region full of live records fails writes without erasing.
+ *
+ * Flash blocks start with an 8-byte header holding a magic number and a block sequence number, which orders blocks across restarts.
+ * @tparam Flash The flash type, providing `bool read(size_t address, uint8_t* out, size_t size)`, `bool program(size_t address, const uint8_t* data, size_t size)` and `bool erase(size_t block)`, such as `jjflash`. It must allow programming any byte range once after an erase, like NOR flash.
+ * @tparam Blocks The number of blocks in the region (at least 2).
+ * @tparam MaxRecords The maximum number of record types in the index.
+ * @tparam Crc16 The CRC-16 implementation, see @ref crc16.
+ */
+template <typename Flash, size_t Blocks, size_t MaxRecords = 64, typename Crc16 = jjrecord_crc16_bitwise>
+class jjrecordlog {
+public:
+	static_assert(Blocks >= 2, "At least two blocks are needed");
+	/**
+	 * The size of each entry header, in bytes.
+	 */
+	static constexpr size_t entry_header_size = jjrecord_header_size + 2;
+	/**
+	 * The size of each block header, in bytes.
+	 */
+	static constexpr size_t block_header_size = 8;
+	/**
+	 * The type reserved to mark erased space.
+	 */
+	static constexpr uint8_t erased_type = 0xFF;
+
+	/**
+	 * @param flash The flash memory.
+	 * @param block_size The size of the flash blocks, in bytes.
+	 * @param first_block The first block of the region.
+	 */
+	jjrecordlog(Flash& flash, size_t block_size, size_t first_block = 0) noexcept : flash(flash), block_size(block_size), first_block(first_block) {}
+	jjrecordlog(const jjrecordlog&) = delete;
+	jjrecordlog& operator=(const jjrecordlog&) = delete;
+
+	/**
+	 * @return The largest payload of a record, in bytes.
+	 */
+	size_t max_payload_size() const noexcept {
+		const auto room = block_size - block_header_size - entry_header_size;
+		return room < 0xFFFF? room : 0xFFFF;
+	}
+
+	/**
+	 * Scan the region and rebuild the index, then finish any compaction interrupted by a power loss.
+	 * @return true if the region could be read. An empty or blank region mounts successfully with no records.
+	 */
+	bool mount() noexcept {
+		if(!scan_all()) {
+			return false;
+		}
+		// Only an interrupted compaction leaves no free block
+		return free_blocks() > 0 || finish_compaction();
+	}
+
+	/**
+	 * Write a record, replacing its previous value.
+	 * @param type The record type, which must not be `erased_type`.
+	 * @return true if the record was written, false if it is too large, the index is full, the region is full of live records, or the flash failed.
+	 */
+	bool write(uint8_t type, const void* data, size_t size) noexcept {
+		if(type == erased_type || size > max_payload_size()) {
+			return false;
+		}
+		if(find(type) == nullptr && count == MaxRecords) {
+			return false;
+		}
+		if(!make_room(entry_header_size + size)) {
+			return false;
+		}
+		// Finishing a compaction may have rebuilt the index
+		auto e = find(type);
+		const uint8_t seq = (e != nullptr)? static_cast<uint8_t>(e->seq + 1) : 0;
+		uint8_t header[entry_header_size] = {0, 0, type, seq, static_cast<uint8_t>(size), static_cast<uint8_t>(size >> 8)};
+		auto crc = Crc16::compute(header + 2, entry_header_size - 2);
+		crc = Crc16::compute(static_cast<const uint8_t*>(data), size, crc);
+		header[0] = static_cast<uint8_t>(crc);
+		header[1] = static_cast<uint8_t>(crc >> 8);
+		// The header goes first, so that a torn write fails the CRC instead of looking like erased space
+		const auto at = address(active, write_offset);
+		if(!flash.program(at, header, entry_header_size) || !flash.program(at + entry_header_size, static_cast<const uint8_t*>(data), size)) {
+			write_offset = block_size;
+			return false;
+		}
+		write_offset += entry_header_size + size;
+		if(e == nullptr) {
+			e = &index[count++];
+			e->type = type;
+		}
+		e->block = static_cast<uint32_t>(active);
+		e->offset = static_cast<uint32_t>(at - address(active, 0));
+		e->size = static_cast<uint16_t>(size);
+		e->seq = seq;
+		return true;
+	}
+
+	/**
+	 * Read the latest value of a record.
+	 * @param size The size of the output buffer; larger records are truncated.
+	 * @return The size of the record, or 0 if there is no record of this type or the flash failed.
+	 */
+	size_t read(uint8_t type, void* out, size_t size) noexcept {
+		const auto e = find(type);
+		if(e == nullptr) {
+			return 0;
+		}
+		const auto n = (size < e->size)? size : e->size;
+		if(!flash.read(address(e->block, e->offset + entry_header_size), static_cast<uint8_t*>(out), n)) {
+			return 0;
+		}
+		return e->size;
+	}
+	/**
+	 * @return true if there is a record of this type.
+	 */
+	bool contains(uint8_t type) const noexcept {
+		return find(type) != nullptr;
+	}
+	/**
+	 * @return The number of record types in the index.
+	 */
+	size_t size() const noexcept {
+		return count;
+	}
+	/**
+	 * @return The number of compactions since construction.
+	 */
+	size_t compactions() const noexcept {
+		return compaction_count;
+	}
+private:
+	static constexpr uint32_t magic = 0x474C4A4A; // "JJLG"
+
+	enum block_state_t : uint8_t {
+		dirty,
+		erased,
+		used,
+	};
+	struct entry_t {
+		uint32_t block;
+		uint32_t offset;
+		uint16_t size;
+		uint8_t type;
+		uint8_t seq;
+	};
+
+	static uint32_t read_u32(const uint8_t* p) noexcept {
+		return p[0] | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+	}
+	static void write_u32(uint8_t* p, uint32_t v) noexcept {
+		for(size_t i=0; i<4; ++i) {
+			p[i] = static_cast<uint8_t>(v >> (8 * i));
+		}
+	}
+	size_t address(size_t block, size_t offset) const noexcept {
+		return (first_block + block) * block_size + offset;
+	}
+	entry_t* find(uint8_t type) noexcept {
+		for(size_t i=0; i<count; ++i) {
+			if(index[i].type == type) {
+				return &index[i];
+			}
+		}
+		return nullptr;
+	}
+	const entry_t* find(uint8_t type) const noexcept {
+		return const_cast<jjrecordlog*>(this)->find(type);
+	}
+
+	/**
+	 * @return The used block with the oldest sequence number not marked in `skip`, or `Blocks` if there is none.
+	 */
+	size_t oldest(const bool* skip) const noexcept {
+		size_t best = Blocks;
+		for(size_t b=0; b<Blocks; ++b) {
+			if(state[b] == used && (skip == nullptr || !skip[b]) && (best == Blocks || int32_t(block_seq[b] - block_seq[best]) < 0)) {
+				best = b;
+			}
+		}
+		return best;
+	}
+	size_t free_blocks() const noexcept {
+		size_t n = 0;
+		for(size_t b=0; b<Blocks; ++b) {
+			n += state[b] != used;
+		}
+		return n;
+	}
+	size_t pick_free() const noexcept {
+		size_t pick = Blocks;
+		for(size_t b=0; b<Blocks; ++b) {
+			if(state[b] == erased) {
+				return b;
+			}
+			if(state[b] == dirty && pick == Blocks) {
+				pick = b;
+			}
+		}
+		return pick;
+	}
+
+	/**
+	 * @return The total size of the live entries of a block, in bytes.
+	 */
+	size_t live_size(size_t b) const noexcept {
+		size_t n = 0;
+		for(size_t i=0; i<count; ++i) {
+			if(index[i].block == b) {
+				n += entry_header_size + index[i].size;
+			}
+		}
+		return n;
+	}
+	/**
+	 * @return true if `size` bytes can be appended to the active block.
+	 */
+	bool fits(size_t size) const noexcept {
+		return active != Blocks && write_offset + size <= block_size;
+	}
+
+	/**
+	 * Read the block headers and replay the blocks from oldest to newest, rebuilding the index.
+	 */
+	bool scan_all() noexcept {
+		count = 0;
+		active = Blocks;
+		next_block_seq = 0;
+		for(size_t b=0; b<Blocks; ++b) {
+			uint8_t header[block_header_size];
+			if(!flash.read(address(b, 0), header, block_header_size)) {
+				return false;
+			}
+			if(read_u32(header) == magic) {
+				state[b] = used;
+				block_seq[b] = read_u32(header + 4);
+				if(uint32_t(block_seq[b] + 1 - next_block_seq) < 0x80000000u) {
+					next_block_seq = block_seq[b] + 1;
+				}
+			} else {
+				// Not known to be erased, it will be erased before use
+				state[b] = dirty;
+			}
+		}
+		bool done[Blocks] = {};
+		for(;;) {
+			const auto b = oldest(done);
+			if(b == Blocks) {
+				break;
+			}
+			done[b] = true;
+			size_t end;
+			if(!scan(b, end)) {
+				return false;
+			}
+			active = b;
+			write_offset = end;
+		}
+		return true;
+	}
+	/**
+	 * Index the valid entries of a block, in order.
+	 * @param end Receives the offset after the last valid entry, or the block size if the block holds a torn entry and must not be appended to.
+	 */
+	bool scan(size_t b, size_t& end) noexcept {
+		size_t offset = block_header_size;
+		end = block_size;
+		while(offset + entry_header_size <= block_size) {
+			uint8_t header[entry_header_size];
+			if(!flash.read(address(b, offset), header, entry_header_size)) {
+				return false;
+			}
+			const auto type = header[2];
+			const size_t size = header[4] | (header[5] << 8);
+			if(type == erased_type && header[0] == 0xFF && header[1] == 0xFF && size == 0xFFFF) {
+				end = offset;
+				return true;
+			}
+			if(type == erased_type || offset + entry_header_size + size > block_size) {
+				return true;
+			}
+			// Check the CRC in chunks, without buffering the whole payload
+			auto crc = Crc16::compute(header + 2, entry_header_size - 2);
+			uint8_t chunk[64];
+			for(size_t i=0; i<size; i+=sizeof(chunk)) {
+				const auto n = (size - i < sizeof(chunk))? size - i : sizeof(chunk);
+				if(!flash.read(address(b, offset + entry_header_size + i), chunk, n)) {
+					return false;
+				}
+				crc = Crc16::compute(chunk, n, crc);
+			}
+			if((header[0] | (header[1] << 8)) != crc) {
+				return true;
+			}
+			auto e = find(type);
+			if(e == nullptr) {
+				if(count == MaxRecords) {
+					return true;
+				}
+				e = &index[count++];
+				e->type = type;
+			}
+			e->block = static_cast<uint32_t>(b);
+			e->offset = static_cast<uint32_t>(offset);
+			e->size = static_cast<uint16_t>(size);
+			e->seq = header[3];
+			offset += entry_header_size + size;
+		}
+		end = offset;
+		return true;
+	}
+
+	/**
+	 * Erase a free block if needed, and make it the active block.
+	 */
+	bool open_block(size_t b) noexcept {
+		if(b == Blocks) {
+			return false;
+		}
+		if(state[b] != erased && !flash.erase(first_block + b)) {
+			return false;
+		}
+		state[b] = erased;
+		uint8_t header[block_header_size];
+		write_u32(header, magic);
+		write_u32(header + 4, next_block_seq);
+		if(!flash.program(address(b, 0), header, block_header_size)) {
+			state[b] = dirty;
+			return false;
+		}
+		state[b] = used;
+		block_seq[b] = next_block_seq++;
+		active = b;
+		write_offset = block_header_size;
+		return true;
+	}
+
+	/**
+	 * Make room for an entry in the active block, opening a free block or compacting the oldest block.
+	 * @return true if the entry fits the active block. Nothing is erased when compacting would not make enough room.
+	 */
+	bool make_room(size_t need) noexcept {
+		if(free_blocks() == 0 && !finish_compaction()) {
+			return false;
+		}
+		if(fits(need)) {
+			return true;
+		}
+		if(free_blocks() >= 2) {
+			return open_block(pick_free());
+		}
+		// The block compacted into only has room for what the oldest block does not keep live
+		const auto from = oldest(nullptr);
+		if(from == Blocks || block_header_size + live_size(from) + need > block_size) {
+			return false;
+		}
+		return compact(from);
+	}
+
+	/**
+	 * Copy the live entries of a block into the free block, then erase it.
+	 */
+	bool compact(size_t from) noexcept {
+		return block_header_size + live_size(from) <= block_size && open_block(pick_free()) && copy_live(from) && release(from);
+	}
+	/**
+	 * Finish a compaction that left no free block, interrupted by a power loss or a flash failure before the erase of its source.
+	 * The newest block is the block compacted into, and the oldest one is the source.
+	 */
+	bool finish_compaction() noexcept {
+		const auto from = oldest(nullptr);
+		if(from == Blocks || from == active) {
+			return false;
+		}
+		if(fits(live_size(from))) {
+			// Copy the entries left, the ones already copied are indexed in the newest block
+			return copy_live(from) && release(from);
+		}
+		// The copy was torn: the newest block only holds copies of entries the source still has, so start over
+		const auto to = active;
+		if(!flash.erase(first_block + to) || !scan_all()) {
+			return false;
+		}
+		state[to] = erased;
+		return compact(from);
+	}
+	/**
+	 * Append the live entries of a block to the active block, updating the index.
+	 */
+	bool copy_live(size_t from) noexcept {
+		for(size_t i=0; i<count; ++i) {
+			auto& e = index[i];
+			if(e.block != from) {
+				continue;
+			}
+			const auto size = entry_header_size + e.size;
+			uint8_t chunk[64];
+			for(size_t k=0; k<size; k+=sizeof(chunk)) {
+				const auto n = (size - k < sizeof(chunk))? size - k : sizeof(chunk);
+				if(!flash.read(address(from, e.offset + k), chunk, n) || !flash.program(address(active, write_offset + k), chunk, n)) {
+					write_offset = block_size;
+					return false;
+				}
+			}
+			e.block = static_cast<uint32_t>(active);
+			e.offset = static_cast<uint32_t>(write_offset);
+			write_offset += size;
+		}
+		return true;
+	}
+	/**
+	 * Erase a block whose entries have all been copied.
+	 */
+	bool release(size_t from) noexcept {
+		if(!flash.erase(first_block + from)) {
+			state[from] = dirty;
+			return false;
+		}
+		state[from] = erased;
+		++compaction_count;
+		return true;
+	}
+
+	Flash& flash;
+	const size_t block_size;
+	const size_t first_block;
+	entry_t index[MaxRecords];
+	size_t count = 0;
+	block_state_t state[Blocks] = {};
+	uint32_t block_seq[Blocks] = {};
+	uint32_t next_block_seq = 0;
+	size_t active = Blocks;
+	size_t write_offset = 0;
+	size_t compaction_count = 0;
+};
+
+template <typename Flash, size_t Blocks, size_t MaxRecords, typename Crc16>
+constexpr size_t jjrecordlog<Flash, Blocks, MaxRecords, Crc16>::entry_header_size;
+template <typename Flash, size_t Blocks, size_t MaxRecords, typename Crc16>
+constexpr size_t jjrecordlog<Flash, Blocks, MaxRecords, Crc16>::block_header_size;
+template <typename Flash, size_t Blocks, size_t MaxRecords, typename Crc16>
+constexpr uint8_t jjrecordlog<Flash, Blocks, MaxRecords, Crc16>::erased_type;
+template <typename Flash, size_t Blocks, size_t MaxRecords, typename Crc16>
+constexpr uint32_t jjrecordlog<Flash, Blocks, MaxRecords, Crc16>::magic;
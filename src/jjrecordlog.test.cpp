@@ -0,0 +1,290 @@
+#include "../ext/doctest.h"
+#include "test.hpp"
+#include "jjflash.hpp"
+#include "jjrecordlog.hpp"
+#include <cstring>
+#include <vector>
+
+TEST_SUITE_BEGIN("jjrecordlog");
+
+struct jjrecordlog_flash_t {
+	test_file_t file;
+	jjflash flash;
+
+	explicit jjrecordlog_flash_t(size_t block_count, size_t block_size = 512) {
+		jjflash_geometry geometry;
+		geometry.page_size = 64;
+		geometry.block_size = block_size;
+		geometry.block_count = block_count;
+		REQUIRE(flash.open(file.path.c_str(), geometry));
+	}
+	~jjrecordlog_flash_t() {
+		flash.close();
+	}
+};
+
+/**
+ * A flash losing power after a given number of programs and erases, or of erases only: the program cut is torn halfway, the erase cut does not happen, and nothing is written afterwards.
+ */
+struct jjrecordlog_powercut_t {
+	jjflash& flash;
+	size_t operations_left = SIZE_MAX;
+	size_t erases_left = SIZE_MAX;
+
+	bool read(size_t address, uint8_t* out, size_t size) {
+		return flash.read(address, out, size);
+	}
+	bool program(size_t address, const uint8_t* data, size_t size) {
+		if(operations_left == 0) {
+			return false;
+		}
+		if(--operations_left == 0) {
+			flash.program(address, data, size / 2);
+			return false;
+		}
+		return flash.program(address, data, size);
+	}
+	bool erase(size_t block) {
+		if(operations_left == 0 || --operations_left == 0 || erases_left-- == 0) {
+			operations_left = 0;
+			return false;
+		}
+		return flash.erase(block);
+	}
+};
+
+using jjrecordlog_test_t = jjrecordlog<jjflash, 4, 8>;
+
+TEST_CASE("[jjrecordlog] records of many types share blocks") {
+	jjrecordlog_flash_t f(4);
+	jjrecordlog_test_t log(f.flash, 512);
+	CHECK(log.mount() == true);
+	CHECK(log.size() == 0);
+	char out[16] = {};
+	CHECK(log.read(1, out, sizeof(out)) == 0);
+
+	CHECK(log.write(1, "one", 4) == true);
+	CHECK(log.write(2, "two", 4) == true);
+	CHECK(log.write(1, "uno", 4) == true);
+	CHECK(log.write(3, "", 0) == true);
+	CHECK(log.size() == 3);
+	CHECK(log.read(1, out, sizeof(out)) == 4);
+	CHECK(std::strcmp(out, "uno") == 0);
+	CHECK(log.read(2, out, 2) == 4); // Truncated
+	CHECK(std::strncmp(out, "tw", 2) == 0);
+	CHECK(log.contains(3) == true);
+	CHECK(log.contains(4) == false);
+	CHECK(f.flash.total_erase_count() == 1);
+
+	CHECK(log.write(jjrecordlog_test_t::erased_type, "x", 1) == false);
+	CHECK(log.write(5, out, log.max_payload_size() + 1) == false);
+
+	// The index is rebuilt at mount
+	jjrecordlog_test_t again(f.flash, 512);
+	CHECK(again.mount() == true);
+	CHECK(again.size() == 3);
+	CHECK(again.read(1, out, sizeof(out)) == 4);
+	CHECK(std::strcmp(out, "uno") == 0);
+	CHECK(again.write(2, "dos", 4) == true);
+	CHECK(again.read(2, out, sizeof(out)) == 4);
+	CHECK(std::strcmp(out, "dos") == 0);
+}
+
+TEST_CASE("[jjrecordlog] compaction keeps the latest values and bounds erases") {
+	jjrecordlog_flash_t f(4);
+	jjrecordlog_test_t log(f.flash, 512);
+	REQUIRE(log.mount());
+	uint32_t values[8] = {};
+	for(uint32_t i=0; i<2000; ++i) {
+		const auto type = static_cast<uint8_t>(i * 7 % 8);
+		values[type] = i;
+		REQUIRE(log.write(type, &values[type], sizeof(uint32_t)));
+	}
+	CHECK(log.compactions() > 0);
+	// 2000 entries of 10 bytes are about 40 blocks of 504 bytes
+	CHECK(f.flash.total_erase_count() <= 45);
+
+	jjrecordlog_test_t again(f.flash, 512);
+	REQUIRE(again.mount());
+	CHECK(again.size() == 8);
+	for(uint8_t type=0; type<8; ++type) {
+		uint32_t v = 0;
+		CHECK(again.read(type, &v, sizeof(v)) == sizeof(v));
+		CHECK(v == values[type]);
+	}
+}
+
+TEST_CASE("[jjrecordlog] torn writes keep the previous value") {
+	jjrecordlog_flash_t f(4);
+	jjrecordlog_test_t log(f.flash, 512);
+	REQUIRE(log.mount());
+	CHECK(log.write(1, "old", 4) == true);
+	CHECK(log.write(1, "new", 4) == true);
+	// Clear a bit of the last payload, as if power was lost while programming it
+	const uint8_t torn = 0x00;
+	REQUIRE(f.flash.program(8 + 2 * jjrecordlog_test_t::entry_header_size + 4 + 1, &torn, 1));
+
+	jjrecordlog_test_t again(f.flash, 512);
+	REQUIRE(again.mount());
+	char out[4];
+	CHECK(again.read(1, out, sizeof(out)) == 4);
+	CHECK(std::strcmp(out, "old") == 0);
+	// The torn block is not appended to anymore
+	CHECK(again.write(1, "next", 5) == true);
+	char next[5];
+	CHECK(again.read(1, next, sizeof(next)) == 5);
+	CHECK(std::strcmp(next, "next") == 0);
+
+	jjrecordlog_test_t third(f.flash, 512);
+	REQUIRE(third.mount());
+	CHECK(third.read(1, next, sizeof(next)) == 5);
+	CHECK(std::strcmp(next, "next") == 0);
+}
+
+TEST_CASE("[jjrecordlog][limits] writes fail when live records do not fit") {
+	jjrecordlog_flash_t f(2);
+	jjrecordlog<jjflash, 2, 8> log(f.flash, 512);
+	REQUIRE(log.mount());
+	uint8_t big[200] = {};
+	CHECK(log.write(1, big, sizeof(big)) == true);
+	CHECK(log.write(2, big, sizeof(big)) == true);
+	CHECK(f.flash.total_erase_count() == 1);
+	for(int i=0; i<5; ++i) {
+		CHECK(log.write(3, big, sizeof(big)) == false); // 3 live records exceed a block
+		CHECK(log.write(1, big, sizeof(big)) == false); // Replacing needs room for both values
+	}
+	// Rejected writes neither compact nor erase
+	CHECK(f.flash.total_erase_count() == 1);
+	CHECK(log.compactions() == 0);
+	CHECK(log.write(1, big, 60) == true);
+	for(uint8_t type=4; type<10; ++type) {
+		CHECK(log.write(type, big, 0) == true);
+	}
+	CHECK(log.size() == 8);
+	CHECK(log.compactions() == 1);
+	CHECK(f.flash.total_erase_count() == 3);
+	CHECK(log.write(10, big, 0) == false); // Index full
+	CHECK(log.write(3, big, sizeof(big)) == false);
+	CHECK(f.flash.total_erase_count() == 3);
+}
+
+TEST_CASE("[jjrecordlog][powercut] a power loss at any point keeps the records and the log writable") {
+	constexpr size_t types = 8;
+	constexpr size_t writes = 150; // 3 blocks of about 50 entries, with compactions
+	size_t cuts = 0;
+	for(size_t cut=1; ; ++cut) {
+		jjrecordlog_flash_t f(3);
+		jjrecordlog_powercut_t flash{f.flash, cut};
+		uint32_t values[types] = {};
+		uint32_t pending = 0;
+		size_t pending_type = types;
+		{
+			jjrecordlog<jjrecordlog_powercut_t, 3, types> log(flash, 512);
+			REQUIRE(log.mount());
+			for(uint32_t i=1; i<=writes; ++i) {
+				const auto type = i % types;
+				if(!log.write(static_cast<uint8_t>(type), &i, sizeof(i))) {
+					pending = i;
+					pending_type = type;
+					break;
+				}
+				values[type] = i;
+			}
+		}
+		if(pending_type == types) {
+			// The power was never cut
+			break;
+		}
+		++cuts;
+
+		// Power is back
+		flash.operations_left = SIZE_MAX;
+		jjrecordlog<jjrecordlog_powercut_t, 3, types> log(flash, 512);
+		REQUIRE(log.mount());
+		for(size_t type=0; type<types; ++type) {
+			uint32_t v = 0;
+			const auto n = log.read(static_cast<uint8_t>(type), &v, sizeof(v));
+			if(type == pending_type && n == sizeof(v) && v == pending) {
+				values[type] = pending;
+			}
+			CHECK(n == (values[type] != 0? sizeof(v) : 0));
+			CHECK(v == values[type]);
+		}
+		for(uint32_t i=writes+1; i<=3*writes; ++i) {
+			const auto type = i % types;
+			REQUIRE(log.write(static_cast<uint8_t>(type), &i, sizeof(i)));
+			values[type] = i;
+		}
+		jjrecordlog<jjrecordlog_powercut_t, 3, types> again(flash, 512);
+		REQUIRE(again.mount());
+		for(size_t type=0; type<types; ++type) {
+			uint32_t v = 0;
+			CHECK(again.read(static_cast<uint8_t>(type), &v, sizeof(v)) == sizeof(v));
+			CHECK(v == values[type]);
+		}
+	}
+	CHECK(cuts > 300);
+}
+
+TEST_CASE("[jjrecordlog][powercut] a power loss before the compaction erase is finished at mount") {
+	jjrecordlog_flash_t f(3);
+	// Opening the first 2 blocks and the block compacted into, but not erasing the compacted block
+	jjrecordlog_powercut_t flash{f.flash};
+	flash.erases_left = 3;
+	uint32_t values[8] = {};
+	uint32_t i = 1;
+	{
+		jjrecordlog<jjrecordlog_powercut_t, 3, 8> log(flash, 512);
+		REQUIRE(log.mount());
+		for(; log.write(static_cast<uint8_t>(i % 8), &i, sizeof(i)); ++i) {
+			values[i % 8] = i;
+		}
+	}
+	CHECK(i > 90); // 2 blocks of about 50 entries
+	CHECK(f.flash.total_erase_count() == 3);
+
+	// Every block is used, the compaction is finished at mount
+	jjrecordlog<jjflash, 3, 8> log(f.flash, 512);
+	REQUIRE(log.mount());
+	CHECK(log.compactions() == 1);
+	CHECK(f.flash.total_erase_count() == 4);
+	for(uint32_t k=1; k<=500; ++k) {
+		REQUIRE(log.write(static_cast<uint8_t>(k % 8), &values[k % 8], sizeof(uint32_t)));
+	}
+	jjrecordlog<jjflash, 3, 8> again(f.flash, 512);
+	REQUIRE(again.mount());
+	for(uint8_t type=0; type<8; ++type) {
+		uint32_t v = 0;
+		CHECK(again.read(type, &v, sizeof(v)) == sizeof(v));
+		CHECK(v == values[type]);
+	}
+}
+
+TEST_CASE("[jjrecordlog][bench] erase cycles against one jjrecord region per record" * doctest::skip()) {
+	constexpr size_t records = 40;
+	constexpr size_t updates = 200;
+	// One jjrecord per record, with 2 slots of one 4 KB block each
+	jjrecordlog_flash_t separate(records * 2, 4096);
+	using record_t = jjrecord<0x10, 4096, 2>;
+	for(size_t r=0; r<records; ++r) {
+		jjflash_slots<record_t> slots(separate.flash, r * record_t::total_size);
+		record_t record;
+		for(size_t u=0; u<updates; ++u) {
+			REQUIRE(record.write_next([&](size_t i, const uint8_t* data, size_t size) { return slots.write(i, data, size); }));
+		}
+	}
+	// All records in a shared log of 8 blocks
+	jjrecordlog_flash_t shared(8, 4096);
+	jjrecordlog<jjflash, 8> log(shared.flash, 4096);
+	REQUIRE(log.mount());
+	uint8_t payload[32] = {};
+	for(size_t u=0; u<updates; ++u) {
+		for(size_t r=0; r<records; ++r) {
+			REQUIRE(log.write(static_cast<uint8_t>(r), payload, sizeof(payload)));
+		}
+	}
+	MESSAGE(records << " records x " << updates << " updates of 32 bytes: separate jjrecords " << separate.flash.total_erase_count()
+		<< " erases in " << records * 2 * 4 << " KB, shared log " << shared.flash.total_erase_count() << " erases in 32 KB");
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,303 @@
+#pragma once
+#include "jjrecord.hpp"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * A record with rotating slots whose payload is too large to hold in RAM, written and read as a stream of fixed-size chunks.
+ *
+ * Each slot starts with a header holding its CRC-16, the record type, the sequence number, the payload length and the CRC-32C of the whole payload.
+ * The payload follows in chunks of `Chunk` bytes, each followed by its own CRC-16, seeded with the sequence number so that chunks left over from an older record in the same slot are rejected.
+ * The header is written last, once all chunks are in place, so that an interrupted write leaves the slot invalid.
+ *
+ * Reads validate each chunk before passing it on, so corruption is detected early without reading the rest of the slot; the record is only complete when the whole-payload CRC also matches.
+ * Only one chunk is buffered in RAM.
+ * @tparam Type The magic number identifying the record type.
+ * @tparam Size The maximum size of the payload, in bytes.
+ * @tparam Chunk The size of each chunk, in bytes.
+ * @tparam Redundancy The number of slots to use for rotating copies of the record.
+ * @tparam Crc16 The CRC-16 implementation of the header and chunk checks, see @ref crc16.
+ * @tparam Seq The unsigned type of the sequence numbers, whose range must be at least twice `Redundancy`.
+ */
+template <uint8_t Type, size_t Size, size_t Chunk, size_t Redundancy, typename Crc16 = jjrecord_crc16_bitwise, typename Seq = uint8_t>
+class jjrecordstream {
+public:
+	static_assert(Chunk > 0 && Chunk <= Size, "Chunk must be between 1 and Size.");
+	static_assert(Size <= UINT32_MAX, "Size must fit 32 bits.");
+	static_assert(Redundancy > 0 && Redundancy <= std::numeric_limits<Seq>::max() / 2 + 1, "Redundancy must be at most half the range of the sequence number type.");
+
+	/**
+	 * The magic number identifying the record type.
+	 */
+	static constexpr uint8_t type = Type;
+	/**
+	 * The maximum size of the payload, in bytes.
+	 */
+	static constexpr size_t size = Size;
+	/**
+	 * The size of each chunk, in bytes.
+	 */
+	static constexpr size_t chunk_size = Chunk;
+	/**
+	 * The number of slots to use for rotating copies of the record.
+	 */
+	static constexpr size_t redundancy = Redundancy;
+	/**
+	 * The size of the slot header (CRC-16, type, sequence number, payload length and payload CRC-32C), in bytes.
+	 */
+	static constexpr size_t header_size = 2 + 1 + sizeof(Seq) + 4 + 4;
+	/**
+	 * The maximum number of chunks of a slot.
+	 */
+	static constexpr size_t chunk_count = (Size + Chunk - 1) / Chunk;
+	/**
+	 * The size of each slot, in bytes.
+	 */
+	static constexpr size_t slot_size = header_size + chunk_count * (Chunk + 2);
+	/**
+	 * The total size taken by the record with all its slots, in bytes.
+	 */
+	static constexpr size_t total_size = slot_size * redundancy;
+
+	/**
+	 * A slot within the record storage area.
+	 */
+	struct slot_t {
+		size_t index;
+		Seq sequence_number;
+
+		/**
+		 * @return The next slot in the rotation.
+		 */
+		constexpr slot_t next() const {
+			return {(index + 1) % Redundancy, static_cast<Seq>(sequence_number + 1)};
+		}
+	};
+
+	jjrecordstream() noexcept : slot{0, 0} {}
+	jjrecordstream(slot_t slot) noexcept : slot{slot} {}
+
+	/**
+	 * The current slot position.
+	 */
+	slot_t current_slot() const noexcept {
+		return slot;
+	}
+	/**
+	 * @return The payload length of the record found by the last successful `read()`, or written by the last successful `end()`.
+	 */
+	size_t length() const noexcept {
+		return record_length;
+	}
+
+	/**
+	 * Read the record from storage, passing its payload chunk by chunk to a consumer as each chunk is validated.
+	 * Slot headers are read first, then slots are streamed from the newest candidate down, with the same rules as `jjrecord::read_newest_first()`.
+	 * When a slot turns out to be corrupted, the consumer is restarted at offset 0 with the next newest slot.
+	 * @param read_fn The function used to read part of a slot from storage, with signature `bool read_fn(size_t slot_index, size_t offset, uint8_t* out, size_t size)`.
+	 * @param consume The function receiving the payload, with signature `bool consume(size_t offset, const uint8_t* data, size_t size)`, returning false to stop reading. The data is only final once `read()` returns true.
+	 * @return true if a valid record was read in full, false if none was found, the storage failed, or the consumer stopped.
+	 */
+	template <typename ReadFn, typename ConsumeFn>
+	bool read(ReadFn&& read_fn, ConsumeFn&& consume) {
+		Seq seqnums[redundancy];
+		uint32_t lengths[redundancy];
+		uint32_t crcs[redundancy];
+		bool candidates[redundancy];
+		for(size_t i=0; i<redundancy; ++i) {
+			if(!read_fn(i, 0, buffer, header_size)) {
+				return false;
+			}
+			candidates[i] = parse_header(buffer, seqnums[i], lengths[i], crcs[i]);
+		}
+		for(;;) {
+			const auto newest = slot_rules::newest_candidate(candidates, seqnums);
+			if(newest == redundancy) {
+				return false;
+			}
+			const auto seqnum = seqnums[newest];
+			const auto result = stream(newest, seqnum, lengths[newest], crcs[newest], read_fn, consume);
+			if(result == stream_valid) {
+				slot = {newest, seqnum};
+				record_length = lengths[newest];
+				return true;
+			}
+			if(result == stream_stopped) {
+				return false;
+			}
+			candidates[newest] = false;
+		}
+	}
+
+	/**
+	 * Start writing a new record to the next slot.
+	 * @note The next slot must be writable, for instance erased on flash memory, and reads must not be interleaved with the writes of a record.
+	 */
+	void begin() noexcept {
+		writing = slot.next();
+		written = 0;
+		fill = 0;
+		chunk_index = 0;
+		payload_crc = 0;
+		broken = false;
+	}
+	/**
+	 * Append data to the record being written, writing full chunks to storage.
+	 * @param write_fn The function used to write part of a slot to storage, with signature `bool write_fn(size_t slot_index, size_t offset, const uint8_t* data, size_t size)`.
+	 * @return true if the data was appended, false if the payload would exceed `size` or the storage failed, in which case the record cannot be completed.
+	 */
+	template <typename WriteFn>
+	bool write(const void* data, size_t n, WriteFn&& write_fn) {
+		if(broken || n > Size - written) {
+			broken = true;
+			return false;
+		}
+		auto in = static_cast<const uint8_t*>(data);
+		written += n;
+		while(n > 0) {
+			const auto part = (Chunk - fill < n)? Chunk - fill : n;
+			std::copy_n(in, part, buffer + fill);
+			fill += part;
+			in += part;
+			n -= part;
+			if(fill == Chunk && !flush(write_fn)) {
+				return false;
+			}
+		}
+		return true;
+	}
+	/**
+	 * Write the last chunk and the header of the record being written, making it the current slot.
+	 * @param write_fn The function used to write part of a slot to storage, see `write()`.
+	 * @return true if the record was completed, false if an earlier write failed or the storage failed.
+	 */
+	template <typename WriteFn>
+	bool end(WriteFn&& write_fn) {
+		if(broken || (fill > 0 && !flush(write_fn))) {
+			return false;
+		}
+		uint8_t header[header_size];
+		header[2] = type;
+		for(size_t i=0; i<sizeof(Seq); ++i) {
+			header[3 + i] = static_cast<uint8_t>(writing.sequence_number >> (8 * i));
+		}
+		write_u32(header + 3 + sizeof(Seq), static_cast<uint32_t>(written));
+		write_u32(header + 7 + sizeof(Seq), payload_crc);
+		const auto crc = Crc16::compute(header + 2, header_size - 2);
+		header[0] = static_cast<uint8_t>(crc);
+		header[1] = static_cast<uint8_t>(crc >> 8);
+		if(!write_fn(writing.index, size_t(0), static_cast<const uint8_t*>(header), header_size)) {
+			broken = true;
+			return false;
+		}
+		slot = writing;
+		record_length = written;
+		return true;
+	}
+private:
+	// The jjrecord with the same slot count and sequence numbers, whose rules select the newest slot
+	using slot_rules = jjrecord<Type, slot_size, Redundancy, jjrecord_check_crc16<Crc16>, Seq, size_t>;
+
+	enum stream_result_t {
+		stream_valid,
+		stream_corrupted,
+		stream_stopped,
+	};
+
+	static uint32_t read_u32(const uint8_t* p) noexcept {
+		return p[0] | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+	}
+	static void write_u32(uint8_t* p, uint32_t v) noexcept {
+		for(size_t i=0; i<4; ++i) {
+			p[i] = static_cast<uint8_t>(v >> (8 * i));
+		}
+	}
+	/**
+	 * @return true if the header is valid and of the right type.
+	 */
+	static bool parse_header(const uint8_t* in, Seq& seqnum, uint32_t& length, uint32_t& crc) noexcept {
+		if((in[0] | (in[1] << 8)) != Crc16::compute(in + 2, header_size - 2) || in[2] != type) {
+			return false;
+		}
+		seqnum = 0;
+		for(size_t i=0; i<sizeof(Seq); ++i) {
+			seqnum = static_cast<Seq>(seqnum | Seq(in[3 + i]) << (8 * i));
+		}
+		length = read_u32(in + 3 + sizeof(Seq));
+		crc = read_u32(in + 7 + sizeof(Seq));
+		return length <= Size;
+	}
+	/**
+	 * @return The CRC-16 of a chunk, seeded with the sequence number of its slot.
+	 */
+	static uint16_t chunk_crc(Seq seqnum, const uint8_t* data, size_t n) noexcept {
+		uint8_t seed[sizeof(Seq)];
+		for(size_t i=0; i<sizeof(Seq); ++i) {
+			seed[i] = static_cast<uint8_t>(seqnum >> (8 * i));
+		}
+		return Crc16::compute(data, n, Crc16::compute(seed, sizeof(Seq)));
+	}
+
+	template <typename ReadFn, typename ConsumeFn>
+	stream_result_t stream(size_t index, Seq seqnum, uint32_t length, uint32_t crc, ReadFn& read_fn, ConsumeFn& consume) {
+		uint32_t running = 0;
+		for(size_t offset=0, c=0; offset<length; offset+=Chunk, ++c) {
+			const auto n = (length - offset < Chunk)? length - offset : Chunk;
+			if(!read_fn(index, header_size + c * (Chunk + 2), buffer, n + 2)) {
+				return stream_stopped;
+			}
+			if((buffer[n] | (buffer[n + 1] << 8)) != chunk_crc(seqnum, buffer, n)) {
+				return stream_corrupted;
+			}
+			running = jjrecord_check_crc32c::compute(buffer, n, running);
+			if(!consume(offset, static_cast<const uint8_t*>(buffer), n)) {
+				return stream_stopped;
+			}
+		}
+		return running == crc? stream_valid : stream_corrupted;
+	}
+
+	template <typename WriteFn>
+	bool flush(WriteFn& write_fn) {
+		const auto crc = chunk_crc(writing.sequence_number, buffer, fill);
+		buffer[fill] = static_cast<uint8_t>(crc);
+		buffer[fill + 1] = static_cast<uint8_t>(crc >> 8);
+		if(!write_fn(writing.index, header_size + chunk_index * (Chunk + 2), static_cast<const uint8_t*>(buffer), fill + 2)) {
+			broken = true;
+			return false;
+		}
+		payload_crc = jjrecord_check_crc32c::compute(buffer, fill, payload_crc);
+		++chunk_index;
+		fill = 0;
+		return true;
+	}
+
+	// A chunk and its CRC, or a slot header
+	uint8_t buffer[(Chunk + 2 > header_size)? Chunk + 2 : header_size];
+	slot_t slot;
+	size_t record_length = 0;
+	// Write state
+	slot_t writing = {0, 0};
+	size_t written = 0;
+	size_t fill = 0;
+	size_t chunk_index = 0;
+	uint32_t payload_crc = 0;
+	bool broken = true;
+};
+
+template <uint8_t Type, size_t Size, size_t Chunk, size_t Redundancy, typename Crc16, typename Seq>
+constexpr uint8_t jjrecordstream<Type, Size, Chunk, Redundancy, Crc16, Seq>::type;
+template <uint8_t Type, size_t Size, size_t Chunk, size_t Redundancy, typename Crc16, typename Seq>
+constexpr size_t jjrecordstream<Type, Size, Chunk, Redundancy, Crc16, Seq>::size;
+template <uint8_t Type, size_t Size, size_t Chunk, size_t Redundancy, typename Crc16, typename Seq>
+constexpr size_t jjrecordstream<Type, Size, Chunk, Redundancy, Crc16, Seq>::chunk_size;
+template <uint8_t Type, size_t Size, size_t Chunk, size_t Redundancy, typename Crc16, typename Seq>
+constexpr size_t jjrecordstream<Type, Size, Chunk, Redundancy, Crc16, Seq>::redundancy;
+template <uint8_t Type, size_t Size, size_t Chunk, size_t Redundancy, typename Crc16, typename Seq>
+constexpr size_t jjrecordstream<Type, Size, Chunk, Redundancy, Crc16, Seq>::header_size;
+template <uint8_t Type, size_t Size, size_t Chunk, size_t Redundancy, typename Crc16, typename Seq>
+constexpr size_t jjrecordstream<Type, Size, Chunk, Redundancy, Crc16, Seq>::chunk_count;
+template <uint8_t Type, size_t Size, size_t Chunk, size_t Redundancy, typename Crc16, typename Seq>
+constexpr size_t jjrecordstream<Type, Size, Chunk, Redundancy, Crc16, Seq>::slot_size;
+template <uint8_t Type, size_t Size, size_t Chunk, size_t Redundancy, typename Crc16, typename Seq>
+constexpr size_t jjrecordstream<Type, Size, Chunk, Redundancy, Crc16, Seq>::total_size;
@@ -0,0 +1,198 @@
+#include "../ext/doctest.h"
+#include "jjrecordstream.hpp"
+#include <random>
+#include <vector>
+
+TEST_SUITE_BEGIN("jjrecordstream");
+
+template <typename Stream>
+struct jjrecordstream_storage_t {
+	std::vector<uint8_t> memory = std::vector<uint8_t>(Stream::total_size, 0xFF);
+	size_t bytes_read = 0;
+	bool fail = false;
+
+	bool write(size_t slot_index, size_t offset, const uint8_t* data, size_t size) {
+		REQUIRE(offset + size <= Stream::slot_size);
+		std::copy_n(data, size, memory.data() + slot_index * Stream::slot_size + offset);
+		return !fail;
+	}
+	bool read(size_t slot_index, size_t offset, uint8_t* out, size_t size) {
+		REQUIRE(offset + size <= Stream::slot_size);
+		std::copy_n(memory.data() + slot_index * Stream::slot_size + offset, size, out);
+		bytes_read += size;
+		return !fail;
+	}
+	uint8_t* slot(size_t slot_index) {
+		return memory.data() + slot_index * Stream::slot_size;
+	}
+};
+
+using jjrecordstream_test_t = jjrecordstream<0x5A, 300000, 4096, 2>;
+
+static std::vector<uint8_t> jjrecordstream_blob(size_t size, uint32_t seed) {
+	std::mt19937 rng(seed);
+	std::vector<uint8_t> blob(size);
+	for(auto& b : blob) {
+		b = static_cast<uint8_t>(rng());
+	}
+	return blob;
+}
+
+/**
+ * Write a blob in pieces of varying sizes.
+ */
+template <typename Stream, typename Storage>
+static bool jjrecordstream_write(Stream& stream, Storage& storage, const std::vector<uint8_t>& blob, bool complete = true) {
+	const auto write = [&](size_t slot_index, size_t offset, const uint8_t* data, size_t size) { return storage.write(slot_index, offset, data, size); };
+	stream.begin();
+	for(size_t offset=0, piece=1; offset<blob.size(); piece=piece*3%9999+1) {
+		const auto n = std::min(piece, blob.size() - offset);
+		if(!stream.write(blob.data() + offset, n, write)) {
+			return false;
+		}
+		offset += n;
+	}
+	return !complete || stream.end(write);
+}
+
+/**
+ * Read a record, restarting the output when the consumer is restarted.
+ */
+template <typename Stream, typename Storage>
+static bool jjrecordstream_read(Stream& stream, Storage& storage, std::vector<uint8_t>& out, size_t* restarts = nullptr) {
+	out.clear();
+	size_t starts = 0;
+	const bool ok = stream.read([&](size_t slot_index, size_t offset, uint8_t* data, size_t size) { return storage.read(slot_index, offset, data, size); },
+		[&](size_t offset, const uint8_t* data, size_t size) {
+			if(offset == 0) {
+				out.clear();
+				++starts;
+			}
+			REQUIRE(offset == out.size());
+			REQUIRE(size <= Stream::chunk_size);
+			out.insert(out.end(), data, data + size);
+			return true;
+		});
+	if(restarts != nullptr) {
+		*restarts = starts;
+	}
+	return ok;
+}
+
+TEST_CASE("[jjrecordstream] large records are streamed in chunks") {
+	static_assert(jjrecordstream_test_t::header_size == 12, "CRC-16, type, 8-bit sequence number, length and CRC-32C");
+	static_assert(jjrecordstream_test_t::chunk_count == 74, "300000 bytes in 4 KB chunks");
+	CHECK(sizeof(jjrecordstream_test_t) < 2 * jjrecordstream_test_t::chunk_size);
+
+	jjrecordstream_storage_t<jjrecordstream_test_t> storage;
+	std::vector<uint8_t> out;
+	jjrecordstream_test_t empty;
+	CHECK(jjrecordstream_read(empty, storage, out) == false);
+
+	jjrecordstream_test_t writer;
+	const auto first = jjrecordstream_blob(250000, 1);
+	CHECK(jjrecordstream_write(writer, storage, first) == true);
+	CHECK(writer.current_slot().index == 1);
+	CHECK(writer.length() == first.size());
+	const auto second = jjrecordstream_blob(300000, 2);
+	CHECK(jjrecordstream_write(writer, storage, second) == true);
+	CHECK(writer.current_slot().index == 0);
+
+	jjrecordstream_test_t reader;
+	size_t restarts;
+	CHECK(jjrecordstream_read(reader, storage, out, &restarts) == true);
+	CHECK(restarts == 1);
+	CHECK(out == second);
+	CHECK(reader.length() == second.size());
+	CHECK(reader.current_slot().index == 0);
+	CHECK(reader.current_slot().sequence_number == 2);
+
+	// Empty and chunk-sized records
+	for(const size_t size : {size_t(0), size_t(4096), size_t(4097)}) {
+		const auto blob = jjrecordstream_blob(size, 3);
+		CHECK(jjrecordstream_write(writer, storage, blob) == true);
+		restarts = 0;
+		CHECK(jjrecordstream_read(reader, storage, out, &restarts) == true);
+		CHECK(restarts == (size > 0? 1 : 0));
+		CHECK(out == blob);
+	}
+}
+
+TEST_CASE("[jjrecordstream] corruption is detected at the chunk and falls back") {
+	jjrecordstream_storage_t<jjrecordstream_test_t> storage;
+	jjrecordstream_test_t writer;
+	const auto old = jjrecordstream_blob(100000, 4);
+	const auto blob = jjrecordstream_blob(200000, 5);
+	REQUIRE(jjrecordstream_write(writer, storage, old));
+	REQUIRE(jjrecordstream_write(writer, storage, blob));
+
+	// A flipped bit in the 3rd chunk stops reading that slot there
+	storage.slot(0)[jjrecordstream_test_t::header_size + 2 * (4096 + 2) + 100] ^= 0x01;
+	jjrecordstream_test_t reader;
+	std::vector<uint8_t> out;
+	size_t restarts;
+	storage.bytes_read = 0;
+	CHECK(jjrecordstream_read(reader, storage, out, &restarts) == true);
+	CHECK(restarts == 2);
+	CHECK(out == old);
+	CHECK(reader.current_slot().index == 1);
+	CHECK(storage.bytes_read <= 2 * jjrecordstream_test_t::header_size + 3 * (4096 + 2) + old.size() + 25 * 2);
+
+	// Corrupted headers are skipped without reading any chunk
+	storage.slot(1)[5] ^= 0x01;
+	storage.bytes_read = 0;
+	CHECK(jjrecordstream_read(reader, storage, out) == false);
+	CHECK(storage.bytes_read == 2 * jjrecordstream_test_t::header_size + 3 * (4096 + 2));
+}
+
+TEST_CASE("[jjrecordstream] interrupted writes leave the previous record") {
+	jjrecordstream_storage_t<jjrecordstream_test_t> storage;
+	jjrecordstream_test_t writer;
+	std::vector<uint8_t> blobs[3] = {jjrecordstream_blob(50000, 6), jjrecordstream_blob(50000, 7), jjrecordstream_blob(60000, 8)};
+	REQUIRE(jjrecordstream_write(writer, storage, blobs[0]));
+	REQUIRE(jjrecordstream_write(writer, storage, blobs[1]));
+	// Overwrite the chunks of the first record, but not its header
+	REQUIRE(jjrecordstream_write(writer, storage, blobs[2], false));
+
+	jjrecordstream_test_t reader;
+	std::vector<uint8_t> out;
+	size_t restarts;
+	CHECK(jjrecordstream_read(reader, storage, out, &restarts) == true);
+	CHECK(restarts == 1);
+	CHECK(out == blobs[1]);
+	CHECK(reader.current_slot().sequence_number == 2);
+	// Without the newest record, the stale header of the overwritten slot is rejected at its first chunk
+	storage.slot(0)[0] ^= 0x01;
+	storage.bytes_read = 0;
+	CHECK(jjrecordstream_read(reader, storage, out) == false);
+	CHECK(storage.bytes_read == 2 * jjrecordstream_test_t::header_size + 4096 + 2);
+	storage.slot(0)[0] ^= 0x01;
+
+	// Write failures and oversized records cannot be completed
+	const auto write = [&](size_t slot_index, size_t offset, const uint8_t* data, size_t size) { return storage.write(slot_index, offset, data, size); };
+	storage.fail = true;
+	CHECK(jjrecordstream_write(writer, storage, blobs[2]) == false);
+	storage.fail = false;
+	CHECK(writer.end(write) == false);
+	writer.begin();
+	CHECK(writer.write(blobs[0].data(), 1, write) == true);
+	CHECK(writer.write(blobs[0].data(), jjrecordstream_test_t::size, write) == false);
+	CHECK(writer.end(write) == false);
+	CHECK(writer.current_slot().sequence_number == 2);
+}
+
+TEST_CASE("[jjrecordstream] consumers and storage can stop reading") {
+	jjrecordstream_storage_t<jjrecordstream_test_t> storage;
+	jjrecordstream_test_t writer;
+	REQUIRE(jjrecordstream_write(writer, storage, jjrecordstream_blob(20000, 9)));
+	const auto read = [&](size_t slot_index, size_t offset, uint8_t* data, size_t size) { return storage.read(slot_index, offset, data, size); };
+
+	jjrecordstream_test_t reader;
+	size_t chunks = 0;
+	CHECK(reader.read(read, [&](size_t, const uint8_t*, size_t) { return ++chunks < 2; }) == false);
+	CHECK(chunks == 2);
+	storage.fail = true;
+	CHECK(reader.read(read, [](size_t, const uint8_t*, size_t) { return true; }) == false);
+}
+
+TEST_SUITE_END();
@@ -1,5 +1,6 @@
 #include "../ext/doctest.h"
 #include "jjreg.hpp"
+#include <string>
 
 TEST_SUITE_BEGIN("jjreg");
 
@@ -1,7 +1,498 @@
+#pragma once
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /**
- * Private implementation details for the ring buffer.
+ * Element size, in bytes, from which bulk pushes use non-temporal stores and bulk pops prefetch the next elements, or 0 to always use plain copies (default).
+ * This pays off for large elements (around 1 KB and more) when the producer and consumer run on different cores, since the producer's cache is not filled with data only the consumer reads.
+ * It is slower when both run on the same core, where the consumer would have found the elements in cache.
+ * Rings of elements smaller than a cache line (`jjring_cache_line`) and single-element pushes and pops never stream nor read this setting.
+ * @note The setting applies to every ring in the process. It may be changed while rings are in use; bulk pushes and pops pick up the new value with a relaxed load.
+ */
+extern std::atomic<size_t> jjring_stream_threshold;
+
+/**
+ * The cache line size assumed when prefetching, in bytes.
+ */
+constexpr size_t jjring_cache_line = 64;
+
+/**
+ * Copy `size` bytes with non-temporal stores where available, so that the copied data does not evict the writer's cache lines.
+ * @note Call `jjring_stream_fence()` before publishing the copied data to another thread.
+ */
+inline void jjring_copy_stream(void* dst, const void* src, size_t size) noexcept {
+#if defined(__SSE2__)
+	auto d = static_cast<char*>(dst);
+	auto s = static_cast<const char*>(src);
+	// Streaming stores need 16-byte aligned destinations
+	const size_t head = (16 - reinterpret_cast<uintptr_t>(d) % 16) % 16;
+	if(head >= size) {
+		std::memcpy(d, s, size);
+		return;
+	}
+	std::memcpy(d, s, head);
+	d += head;
+	s += head;
+	size -= head;
+	for(; size>=64; size-=64, d+=64, s+=64) {
+		const auto in = reinterpret_cast<const __m128i*>(s);
+		const auto out = reinterpret_cast<__m128i*>(d);
+		_mm_stream_si128(out + 0, _mm_loadu_si128(in + 0));
+		_mm_stream_si128(out + 1, _mm_loadu_si128(in + 1));
+		_mm_stream_si128(out + 2, _mm_loadu_si128(in + 2));
+		_mm_stream_si128(out + 3, _mm_loadu_si128(in + 3));
+	}
+	for(; size>=16; size-=16, d+=16, s+=16) {
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s)));
+	}
+	std::memcpy(d, s, size);
+#else
+	std::memcpy(dst, src, size);
+#endif
+}
+
+/**
+ * Order the non-temporal stores of `jjring_copy_stream()` before the following stores.
+ */
+inline void jjring_stream_fence() noexcept {
+#if defined(__SSE2__)
+	_mm_sfence();
+#endif
+}
+
+/**
+ * Copy `count` elements of `elemsize` bytes, prefetching each next element while copying the current one.
+ */
+inline void jjring_copy_prefetch(void* dst, const void* src, size_t count, size_t elemsize) noexcept {
+	auto d = static_cast<char*>(dst);
+	auto s = static_cast<const char*>(src);
+	for(size_t i=0; i<count; ++i, d+=elemsize, s+=elemsize) {
+		if(i + 1 < count) {
+			for(size_t offset=0; offset<elemsize; offset+=jjring_cache_line) {
+				__builtin_prefetch(s + elemsize + offset);
+			}
+		}
+		std::memcpy(d, s, elemsize);
+	}
+}
+
+/**
+ * @return The narrowest unsigned type able to index `N` slots that the target can load and store atomically.
+ */
+template <size_t N, bool Fits8 = (N <= 0x100 && __atomic_always_lock_free(sizeof(uint8_t), 0)), bool Fits16 = (N <= 0x10000 && __atomic_always_lock_free(sizeof(uint16_t), 0)), bool Fits32 = (N <= 0x100000000ull && __atomic_always_lock_free(sizeof(uint32_t), 0))>
+struct jjring_index {
+	using type = size_t;
+};
+template <size_t N, bool Fits16, bool Fits32>
+struct jjring_index<N, true, Fits16, Fits32> {
+	using type = uint8_t;
+};
+template <size_t N, bool Fits32>
+struct jjring_index<N, false, true, Fits32> {
+	using type = uint16_t;
+};
+template <size_t N>
+struct jjring_index<N, false, false, true> {
+	using type = uint32_t;
+};
+
+/**
+ * Concurrency policy for a ring buffer shared by one producer thread and one consumer thread, possibly on different cores.
+ * Index updates use acquire/release atomic operations.
+ */
+struct jjring_spsc {
+	template <typename Index>
+	static Index load_acquire(const Index& x) noexcept {
+		return __atomic_load_n(&x, __ATOMIC_ACQUIRE);
+	}
+	template <typename Index>
+	static Index load_relaxed(const Index& x) noexcept {
+		return __atomic_load_n(&x, __ATOMIC_RELAXED);
+	}
+	template <typename Index>
+	static void store_release(Index& x, Index v) noexcept {
+		__atomic_store_n(&x, v, __ATOMIC_RELEASE);
+	}
+};
+
+/**
+ * Concurrency policy for a ring buffer shared by an interrupt handler and the main loop on a single core.
+ * Index updates are single loads and stores, only ordered against the element copies by compiler barriers.
+ * @warning Not suitable for multi-core systems, where the hardware may reorder memory accesses.
+ */
+struct jjring_isr {
+	template <typename Index>
+	static Index load_acquire(const Index& x) noexcept {
+		const Index v = __atomic_load_n(&x, __ATOMIC_RELAXED);
+		__atomic_signal_fence(__ATOMIC_ACQUIRE);
+		return v;
+	}
+	template <typename Index>
+	static Index load_relaxed(const Index& x) noexcept {
+		return __atomic_load_n(&x, __ATOMIC_RELAXED);
+	}
+	template <typename Index>
+	static void store_release(Index& x, Index v) noexcept {
+		__atomic_signal_fence(__ATOMIC_RELEASE);
+		__atomic_store_n(&x, v, __ATOMIC_RELAXED);
+	}
+};
+
+/**
+ * Concurrency policy for a ring buffer used by a single thread, as a plain FIFO.
+ * Index updates are plain loads and stores, which the compiler is free to keep in registers and reorder.
+ */
+struct jjring_local {
+	template <typename Index>
+	static Index load_acquire(const Index& x) noexcept {
+		return x;
+	}
+	template <typename Index>
+	static Index load_relaxed(const Index& x) noexcept {
+		return x;
+	}
+	template <typename Index>
+	static void store_release(Index& x, Index v) noexcept {
+		x = v;
+	}
+};
+
+/**
+ * A contiguous segment of a ring buffer, as a pointer and a number of elements.
+ * Segments come in pairs, split at the wrap point, like an `iovec` array.
+ */
+template <typename T>
+struct jjring_span {
+	T* data;
+	size_t size;
+};
+
+/**
+ * Private implementation details for the ring buffer: the head and tail indices, and the algorithms working on them.
+ * The storage is described by the caller on each operation, so that it can be fixed at compile time.
+ * @tparam Index The type of the head and tail indices, which must be able to hold `capacity - 1`.
+ * @tparam Policy The concurrency policy, such as `jjring_spsc`, `jjring_isr` or `jjring_local`.
+ * @see jjring_
+ * @see jjring
+ */
+template <typename Index, typename Policy>
+class jjring_core {
+public:
+	using index_type = Index;
+
+	void clear() noexcept;
+	bool empty() const noexcept;
+	bool full(size_t mask) const noexcept;
+	size_t size_approx(size_t mask) const noexcept;
+
+	bool push(char* buf, size_t elemsize, size_t mask, const void*) noexcept;
+	template <bool Stream>
+	size_t push(char* buf, size_t elemsize, size_t mask, const void*, size_t) noexcept;
+	void push_overwrite(char* buf, size_t elemsize, size_t mask, const void*) noexcept;
+	bool pop(const char* buf, size_t elemsize, size_t mask, void*) noexcept;
+	template <bool Stream>
+	size_t pop(const char* buf, size_t elemsize, size_t mask, void*, size_t) noexcept;
+
+	size_t write_acquire(char* buf, size_t elemsize, size_t mask, void**) noexcept;
+	size_t write_acquire_all(char* buf, size_t elemsize, size_t mask, jjring_span<void>*) noexcept;
+	void write_commit(size_t mask, size_t) noexcept;
+	size_t read_acquire(const char* buf, size_t elemsize, size_t mask, const void**) noexcept;
+	size_t read_acquire_all(const char* buf, size_t elemsize, size_t mask, jjring_span<const void>*) noexcept;
+	void read_commit(size_t mask, size_t) noexcept;
+
+	const void* peek_at(const char* buf, size_t elemsize, size_t mask, size_t) const noexcept;
+	size_t peek_n(const char* buf, size_t elemsize, size_t mask, void*, size_t, size_t) const noexcept;
+private:
+	static bool streams(size_t elemsize) noexcept {
+		if(elemsize < jjring_cache_line) {
+			return false;
+		}
+		const auto threshold = jjring_stream_threshold.load(std::memory_order_relaxed);
+		return threshold != 0 && elemsize >= threshold;
+	}
+	static Index load_acquire(const Index& x) noexcept {
+		return Policy::load_acquire(x);
+	}
+	static Index load_relaxed(const Index& x) noexcept {
+		return Policy::load_relaxed(x);
+	}
+	static void store_release(Index& x, size_t v) noexcept {
+		Policy::store_release(x, static_cast<Index>(v));
+	}
+
+	Index head = 0;
+	Index tail = 0;
+};
+
+template <typename Index, typename Policy>
+void jjring_core<Index, Policy>::clear() noexcept {
+	store_release(head, 0);
+	store_release(tail, 0);
+}
+
+template <typename Index, typename Policy>
+bool jjring_core<Index, Policy>::empty() const noexcept {
+	const size_t h = load_acquire(head);
+	const size_t t = load_relaxed(tail);
+	return h == t;
+}
+
+template <typename Index, typename Policy>
+bool jjring_core<Index, Policy>::full(size_t mask) const noexcept {
+	const size_t h = load_relaxed(head);
+	const auto next = (h + 1) & mask;
+	const size_t t = load_acquire(tail);
+	return next == t;
+}
+
+template <typename Index, typename Policy>
+size_t jjring_core<Index, Policy>::size_approx(size_t mask) const noexcept {
+	const size_t h = load_acquire(head);
+	const size_t t = load_relaxed(tail);
+	const auto N = mask + 1;
+	return (h + N - t) & mask;
+}
+
+template <typename Index, typename Policy>
+bool jjring_core<Index, Policy>::push(char* buf, size_t elemsize, size_t mask, const void* src) noexcept {
+	const size_t h = load_relaxed(head);
+	const size_t t = load_acquire(tail);
+	const auto next = (h + 1) & mask;
+	if(next == t) {
+		// The buffer is full
+		return false;
+	}
+	std::memcpy(buf + h * elemsize, src, elemsize);
+	store_release(head, next);
+	return true;
+}
+
+template <typename Index, typename Policy>
+template <bool Stream>
+size_t jjring_core<Index, Policy>::push(char* buf, size_t elemsize, size_t mask, const void* src, size_t size) noexcept {
+	const size_t h = load_relaxed(head);
+	const size_t t = load_acquire(tail);
+	const auto N = mask + 1;
+	const auto space = (t + N - 1 - h) & mask; // keep one empty slot
+	if(space == 0) {
+		return 0;
+	}
+	if(size > space) {
+		size = space;
+	}
+
+	// First contiguous chunk until wrap
+	size_t c1 = N - h;
+	if(c1 > size) {
+		c1 = size;
+	}
+	if(Stream && streams(elemsize)) {
+		// Large elements are only read by the consumer, keep them out of the producer's cache
+		jjring_copy_stream(buf + h * elemsize, src, c1 * elemsize);
+		if(size > c1) {
+			jjring_copy_stream(buf, static_cast<const char*>(src) + c1 * elemsize, (size - c1) * elemsize);
+		}
+		jjring_stream_fence();
+	} else {
+		std::memcpy(buf + h * elemsize, src, c1 * elemsize);
+
+		// Second chunk from start, if needed
+		if(size > c1) {
+			std::memcpy(buf, static_cast<const char*>(src) + c1 * elemsize, (size - c1) * elemsize);
+		}
+	}
+
+	store_release(head, (h + size) & mask);
+	return size;
+}
+
+template <typename Index, typename Policy>
+void jjring_core<Index, Policy>::push_overwrite(char* buf, size_t elemsize, size_t mask, const void* src) noexcept {
+	const size_t h = load_relaxed(head);
+	const size_t t = load_acquire(tail);
+	const auto next = (h + 1) & mask;
+	if(next == t) {
+		// The buffer is full, overwrite the oldest element
+		store_release(tail, (t + 1) & mask);
+	}
+	std::memcpy(buf + h * elemsize, src, elemsize);
+	store_release(head, next);
+}
+
+template <typename Index, typename Policy>
+bool jjring_core<Index, Policy>::pop(const char* buf, size_t elemsize, size_t mask, void* dst) noexcept {
+	const size_t t = load_relaxed(tail);
+	const size_t h = load_acquire(head);
+	if(h == t) {
+		// The buffer is empty
+		return false;
+	}
+	std::memcpy(dst, buf + t * elemsize, elemsize);
+	store_release(tail, (t + 1) & mask);
+	return true;
+}
+
+template <typename Index, typename Policy>
+template <bool Stream>
+size_t jjring_core<Index, Policy>::pop(const char* buf, size_t elemsize, size_t mask, void* dst, size_t size) noexcept {
+	const size_t t = load_relaxed(tail);
+	const size_t h = load_acquire(head);
+	const auto N = mask + 1;
+	const auto avail = (h + N - t) & mask;
+	if(avail == 0) {
+		// The buffer is empty
+		return 0;
+	}
+	if(size > avail) {
+		size = avail;
+	}
+
+	// First contiguous chunk until wrap
+	size_t c1 = N - t;
+	if(c1 > size) {
+		c1 = size;
+	}
+	if(Stream && streams(elemsize)) {
+		// Large elements come from another core's writes, fetch the next ones while copying
+		jjring_copy_prefetch(dst, buf + t * elemsize, c1, elemsize);
+		if(size > c1) {
+			jjring_copy_prefetch(static_cast<char*>(dst) + c1 * elemsize, buf, size - c1, elemsize);
+		}
+	} else {
+		std::memcpy(dst, buf + t * elemsize, c1 * elemsize);
+
+		// Second chunk from start, if needed
+		if(size > c1) {
+			std::memcpy(static_cast<char*>(dst) + c1 * elemsize, buf, (size - c1) * elemsize);
+		}
+	}
+
+	store_release(tail, (t + size) & mask);
+	return size;
+}
+
+template <typename Index, typename Policy>
+size_t jjring_core<Index, Policy>::write_acquire(char* buf, size_t elemsize, size_t mask, void** p) noexcept {
+	const size_t h = load_relaxed(head);
+	const size_t t = load_acquire(tail);
+	const auto N = mask + 1;
+	const auto space = (t + N - 1 - h) & mask; // keep one empty slot
+	if(space == 0) {
+		// The buffer is full
+		*p = nullptr;
+		return 0;
+	}
+	const auto until_wrap = N - h;
+	const auto n = (space < until_wrap)? space : until_wrap;
+	*p = static_cast<void*>(buf + h * elemsize);
+	return n;
+}
+
+template <typename Index, typename Policy>
+size_t jjring_core<Index, Policy>::write_acquire_all(char* buf, size_t elemsize, size_t mask, jjring_span<void>* spans) noexcept {
+	const size_t h = load_relaxed(head);
+	const size_t t = load_acquire(tail);
+	const auto N = mask + 1;
+	const auto space = (t + N - 1 - h) & mask; // keep one empty slot
+
+	const auto until_wrap = N - h;
+	const auto n = (space < until_wrap)? space : until_wrap;
+	spans[0] = {n? buf + h * elemsize : nullptr, n};
+	spans[1] = {space > n? buf : nullptr, space - n};
+	return space;
+}
+
+template <typename Index, typename Policy>
+void jjring_core<Index, Policy>::write_commit(size_t mask, size_t n) noexcept {
+	const size_t h = load_relaxed(head);
+	store_release(head, (h + n) & mask);
+}
+
+template <typename Index, typename Policy>
+size_t jjring_core<Index, Policy>::read_acquire(const char* buf, size_t elemsize, size_t mask, const void** p) noexcept {
+	const size_t t = load_relaxed(tail);
+	const size_t h = load_acquire(head);
+	const auto N = mask + 1;
+	const auto avail = (h + N - t) & mask;
+	if(avail == 0) {
+		// The buffer is empty
+		*p = nullptr;
+		return 0;
+	}
+
+	const auto until_wrap = N - t;
+	const auto n = (avail < until_wrap)? avail : until_wrap;
+	*p = static_cast<const void*>(buf + t * elemsize);
+	return n;
+}
+
+template <typename Index, typename Policy>
+size_t jjring_core<Index, Policy>::read_acquire_all(const char* buf, size_t elemsize, size_t mask, jjring_span<const void>* spans) noexcept {
+	const size_t t = load_relaxed(tail);
+	const size_t h = load_acquire(head);
+	const auto N = mask + 1;
+	const auto avail = (h + N - t) & mask;
+
+	const auto until_wrap = N - t;
+	const auto n = (avail < until_wrap)? avail : until_wrap;
+	spans[0] = {n? buf + t * elemsize : nullptr, n};
+	spans[1] = {avail > n? buf : nullptr, avail - n};
+	return avail;
+}
+
+template <typename Index, typename Policy>
+void jjring_core<Index, Policy>::read_commit(size_t mask, size_t n) noexcept {
+	const size_t t = load_relaxed(tail);
+	store_release(tail, (t + n) & mask);
+}
+
+template <typename Index, typename Policy>
+const void* jjring_core<Index, Policy>::peek_at(const char* buf, size_t elemsize, size_t mask, size_t i) const noexcept {
+	const size_t t = load_relaxed(tail);
+	const size_t h = load_acquire(head);
+	const auto N = mask + 1;
+	const auto avail = (h + N - t) & mask;
+	if(i >= avail) {
+		return nullptr;
+	}
+	return buf + ((t + i) & mask) * elemsize;
+}
+
+template <typename Index, typename Policy>
+size_t jjring_core<Index, Policy>::peek_n(const char* buf, size_t elemsize, size_t mask, void* dst, size_t size, size_t offset) const noexcept {
+	const size_t t = load_relaxed(tail);
+	const size_t h = load_acquire(head);
+	const auto N = mask + 1;
+	const auto avail = (h + N - t) & mask;
+	if(offset >= avail) {
+		return 0;
+	}
+	if(size > avail - offset) {
+		size = avail - offset;
+	}
+	const auto start = (t + offset) & mask;
+
+	// First contiguous chunk until wrap
+	size_t c1 = N - start;
+	if(c1 > size) {
+		c1 = size;
+	}
+	std::memcpy(dst, buf + start * elemsize, c1 * elemsize);
+
+	// Second chunk from start, if needed
+	if(size > c1) {
+		std::memcpy(static_cast<char*>(dst) + c1 * elemsize, buf, (size - c1) * elemsize);
+	}
+	return size;
+}
+
+/**
+ * A ring buffer over runtime-provided storage, working on untyped elements.
  * @see jjring
  */
 class jjring_ {
@@ -27,29 +518,37 @@ public:
 	size_t pop(void*, size_t) noexcept;
 
 	size_t write_acquire(void**) noexcept;
+	size_t write_acquire_all(jjring_span<void>*) noexcept;
 	void write_commit(size_t) noexcept;
 	size_t read_acquire(const void**) noexcept;
+	size_t read_acquire_all(jjring_span<const void>*) noexcept;
 	void read_commit(size_t) noexcept;
+
+	bool peek(void*) const noexcept;
+	const void* peek_at(size_t) const noexcept;
+	size_t peek_n(void*, size_t, size_t) const noexcept;
 private:
-	void* buf;
+	char* const buf;
 	const size_t elemsize;
 	const size_t mask; // N-1
-	size_t head;
-	size_t tail;
+	jjring_core<size_t, jjring_spsc> _;
 };
 
 /**
  * A lock-free single-producer, single-consumer ring buffer, with fixed 2^N capacity.
+ * @tparam Policy The concurrency policy: `jjring_spsc` (default) between threads, `jjring_isr` between an interrupt handler and the main loop on a single core, or `jjring_local` within a single thread.
  */
-template <typename T, size_t N>
+template <typename T, size_t N, typename Policy = jjring_spsc>
 class jjring {
 public:
 	static_assert(N > 1 && (N & (N - 1)) == 0, "N must be a power of 2");
 	static_assert(__is_trivially_copyable(T), "T must be trivially copyable");
 	static_assert(sizeof(T) % alignof(T) == 0, "sizeof(T) must be multiple of alignof(T)");
 	using value_type = T;
-public:
-	jjring() : _(buffer, N, sizeof(T), alignof(T)) {}
+	/**
+	 * The type of the head and tail indices, which is the narrowest one able to hold `N - 1`.
+	 */
+	using index_type = typename jjring_index<N>::type;
 
 	/**
 	 * Clear the ring buffer.
@@ -68,14 +567,14 @@ public:
 	 * @return true if the buffer is full.
 	 */
 	bool full() const noexcept {
-		return _.full();
+		return _.full(mask);
 	}
 	/**
 	 * @return The approximate number of elements in the buffer.
 	 * @note The returned value may be off by one when the buffer is being accessed concurrently.
 	 */
 	size_t size_approx() const noexcept {
-		return _.size_approx();
+		return _.size_approx(mask);
 	}
 	/**
 	 * @return The maximum number of elements that can be stored in the buffer.
@@ -90,7 +589,7 @@ public:
 	 * @return true if the element was pushed successfully, false if the buffer is full.
 	 */
 	bool push(const T& item) noexcept {
-		return _.push(&item);
+		return _.push(bytes(), sizeof(T), mask, &item);
 	}
 	/**
 	 * Push multiple elements into the buffer at once.
@@ -99,7 +598,7 @@ public:
 	 * @return The number of elements successfully pushed.
 	 */
 	size_t push(const T* src, size_t size) noexcept {
-		return _.push(static_cast<const void*>(src), size);
+		return _.template push<streamable>(bytes(), sizeof(T), mask, static_cast<const void*>(src), size);
 	}
 	/**
 	 * Push an element into the buffer, overwriting the oldest element if the buffer is full.
@@ -108,7 +607,7 @@ public:
 	 * @warning Do not use together with long-lived `read_acquire` spans, which can be invalidated.
 	 */
 	void push_overwrite(const T& item) noexcept {
-		_.push_overwrite(&item);
+		_.push_overwrite(bytes(), sizeof(T), mask, &item);
 	}
 	/**
 	 * Pop an element from the buffer.
@@ -116,7 +615,7 @@ public:
 	 * @return true if the element was popped successfully, false if the buffer is empty.
 	 */
 	bool pop(T& item) noexcept {
-		return _.pop(&item);
+		return _.pop(bytes(), sizeof(T), mask, &item);
 	}
 	/**
 	 * Pop multiple elements from the buffer.
@@ -125,7 +624,7 @@ public:
 	 * @return The number of elements successfully popped.
 	 */
 	size_t pop(T* dst, size_t size) noexcept {
-		return _.pop(static_cast<void*>(dst), size);
+		return _.template pop<streamable>(bytes(), sizeof(T), mask, static_cast<void*>(dst), size);
 	}
 
 	/**
@@ -135,7 +634,7 @@ public:
 	 * These functions allow direct access to the buffer memory for writing or reading, avoiding unnecessary copies.
 	 * First, use *_acquire() to obtain a pointer to the buffer memory, from which they can read or write data directly (up to the acquired size).
 	 * Then, use *_commit() to make the changes visible to the other thread.
-	 * @note If the number of elements to write or read exceeds the number of elements that can be written in a call to *_acquire(), the operation must be split into two acquire/commit pairs.
+	 * @note If the number of elements to write or read exceeds the number of elements that can be written in a call to *_acquire(), the operation must be split into two acquire/commit pairs, or use *_acquire_all().
 	 */
 
 	/**
@@ -145,16 +644,30 @@ public:
 	 */
 	size_t write_acquire(T** ptr) noexcept {
 		void* pv;
-		const auto n = _.write_acquire(&pv);
+		const auto n = _.write_acquire(bytes(), sizeof(T), mask, &pv);
 		*ptr = static_cast<T*>(pv);
 		return n;
 	}
+	/**
+	 * Acquire both writable segments of the buffer, before and after the wrap point.
+	 * @param spans Array of two spans receiving the segments, the second one being empty when the free space does not wrap.
+	 * @return The total number of elements that can be written.
+	 * @note Any number of elements up to the returned count can then be committed at once with write_commit(), filling the first segment before the second one.
+	 */
+	size_t write_acquire_all(jjring_span<T> spans[2]) noexcept {
+		jjring_span<void> pv[2];
+		const auto n = _.write_acquire_all(bytes(), sizeof(T), mask, pv);
+		for(size_t i=0; i<2; ++i) {
+			spans[i] = {static_cast<T*>(pv[i].data), pv[i].size};
+		}
+		return n;
+	}
 	/**
 	 * Commit the written elements.
 	 * @note This function must be called after write_acquire() to make the written elements visible to the other thread.
 	 */
 	void write_commit(size_t n) noexcept {
-		_.write_commit(n);
+		_.write_commit(mask, n);
 	}
 	/**
 	 * Acquire a read pointer to the buffer.
@@ -163,18 +676,76 @@ public:
 	 */
 	size_t read_acquire(const T** ptr) noexcept {
 		const void* pv;
-		const auto n = _.read_acquire(&pv);
+		const auto n = _.read_acquire(bytes(), sizeof(T), mask, &pv);
 		*ptr = static_cast<const T*>(pv);
 		return n;
 	}
+	/**
+	 * Acquire both readable segments of the buffer, before and after the wrap point.
+	 * @param spans Array of two spans receiving the segments, the second one being empty when the readable elements do not wrap.
+	 * @return The total number of elements that can be read.
+	 * @note Any number of elements up to the returned count can then be committed at once with read_commit().
+	 */
+	size_t read_acquire_all(jjring_span<const T> spans[2]) noexcept {
+		jjring_span<const void> pv[2];
+		const auto n = _.read_acquire_all(bytes(), sizeof(T), mask, pv);
+		for(size_t i=0; i<2; ++i) {
+			spans[i] = {static_cast<const T*>(pv[i].data), pv[i].size};
+		}
+		return n;
+	}
 	/**
 	 * Commit the read elements.
 	 * @note This function must be called after read_acquire() to make the read elements visible to the other thread.
 	 */
 	void read_commit(size_t n) noexcept {
-		_.read_commit(n);
+		_.read_commit(mask, n);
+	}
+
+	/**
+	 * @defgroup peek Peek operations
+	 * @brief Consumer-side functions reading elements without removing them from the buffer.
+	 *
+	 * Use read_commit() to drop the inspected elements once they have been handled.
+	 */
+
+	/**
+	 * Copy the oldest element without removing it.
+	 * @param item The element to copy to.
+	 * @return true if an element was copied, false if the buffer is empty.
+	 */
+	bool peek(T& item) const noexcept {
+		return _.peek_n(bytes(), sizeof(T), mask, &item, 1, 0) == 1;
+	}
+	/**
+	 * @return A pointer to the element at position `i` from the oldest one, or nullptr if there are not more than `i` elements in the buffer.
+	 * @note The pointer stays valid until the element is committed as read.
+	 */
+	const T* peek_at(size_t i) const noexcept {
+		return static_cast<const T*>(_.peek_at(bytes(), sizeof(T), mask, i));
+	}
+	/**
+	 * Copy multiple elements without removing them.
+	 * @param dst Pointer to the destination buffer.
+	 * @param size The number of elements to copy.
+	 * @param offset The position of the first element to copy, from the oldest one.
+	 * @return The number of elements copied.
+	 */
+	size_t peek_n(T* dst, size_t size, size_t offset = 0) const noexcept {
+		return _.peek_n(bytes(), sizeof(T), mask, static_cast<void*>(dst), size, offset);
 	}
 private:
+	static constexpr size_t mask = N - 1;
+	// Only rings of large elements consult jjring_stream_threshold
+	static constexpr bool streamable = sizeof(T) >= jjring_cache_line;
+
+	char* bytes() noexcept {
+		return reinterpret_cast<char*>(buffer);
+	}
+	const char* bytes() const noexcept {
+		return reinterpret_cast<const char*>(buffer);
+	}
+
 	alignas(alignof(T)) T buffer[N];
-	jjring_ _;
+	jjring_core<index_type, Policy> _;
 };
@@ -4,26 +4,34 @@
 #include <array>
 #include <cstdint>
 #include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <type_traits>
 
 TEST_SUITE_BEGIN("jjring");
 
-TEST_CASE("[jjring][base] construction and capacity") {
-    jjring<int, 8> ring;
+// Every behavior is checked with each concurrency policy
+#define JJRING_POLICIES jjring_spsc, jjring_isr, jjring_local
+
+TEST_CASE_TEMPLATE("[jjring][base] construction and capacity", Policy, JJRING_POLICIES) {
+    jjring<int, 8, Policy> ring;
     
     // Capacity should be N-1 for ring buffer (one slot reserved)
     CHECK(ring.capacity() == 7);
 }
 
-TEST_CASE("[jjring][base] initial state is empty") {
-    jjring<int, 4> ring;
+TEST_CASE_TEMPLATE("[jjring][base] initial state is empty", Policy, JJRING_POLICIES) {
+    jjring<int, 4, Policy> ring;
     
     CHECK(ring.empty() == true);
     CHECK(ring.full() == false);
     CHECK(ring.size_approx() == 0);
 }
 
-TEST_CASE("[jjring][single] single element push and pop") {
-    jjring<int, 4> ring;
+TEST_CASE_TEMPLATE("[jjring][single] single element push and pop", Policy, JJRING_POLICIES) {
+    jjring<int, 4, Policy> ring;
     
     // Test single push
     bool push_result = ring.push(42);
@@ -40,8 +48,8 @@ TEST_CASE("[jjring][single] single element push and pop") {
     CHECK(ring.size_approx() == 0);
 }
 
-TEST_CASE("[jjring][single] push to full buffer returns false") {
-    jjring<int, 4> ring; // capacity = 3
+TEST_CASE_TEMPLATE("[jjring][single] push to full buffer returns false", Policy, JJRING_POLICIES) {
+    jjring<int, 4, Policy> ring; // capacity = 3
     
     // Fill the buffer
     CHECK(ring.push(1) == true);
@@ -54,16 +62,16 @@ TEST_CASE("[jjring][single] push to full buffer returns false") {
     CHECK(ring.size_approx() == 3);
 }
 
-TEST_CASE("[jjring][single] pop from empty buffer returns false") {
-    jjring<int, 4> ring;
+TEST_CASE_TEMPLATE("[jjring][single] pop from empty buffer returns false", Policy, JJRING_POLICIES) {
+    jjring<int, 4, Policy> ring;
     
     int value;
     CHECK(ring.pop(value) == false);
     CHECK(ring.empty() == true);
 }
 
-TEST_CASE("[jjring][bulk] bulk push and pop operations") {
-    jjring<int, 8> ring; // capacity = 7
+TEST_CASE_TEMPLATE("[jjring][bulk] bulk push and pop operations", Policy, JJRING_POLICIES) {
+    jjring<int, 8, Policy> ring; // capacity = 7
     
     // Prepare test data
     std::vector<int> input_data = {1, 2, 3, 4, 5};
@@ -85,8 +93,8 @@ TEST_CASE("[jjring][bulk] bulk push and pop operations") {
     }
 }
 
-TEST_CASE("[jjring][bulk] bulk operations with partial success") {
-    jjring<int, 4> ring; // capacity = 3
+TEST_CASE_TEMPLATE("[jjring][bulk] bulk operations with partial success", Policy, JJRING_POLICIES) {
+    jjring<int, 4, Policy> ring; // capacity = 3
     
     // Try to push more than capacity
     std::vector<int> input_data = {1, 2, 3, 4, 5};
@@ -106,8 +114,8 @@ TEST_CASE("[jjring][bulk] bulk operations with partial success") {
     }
 }
 
-TEST_CASE("[jjring][ovw] push_overwrite when buffer has space") {
-    jjring<int, 4> ring; // capacity = 3
+TEST_CASE_TEMPLATE("[jjring][ovw] push_overwrite when buffer has space", Policy, JJRING_POLICIES) {
+    jjring<int, 4, Policy> ring; // capacity = 3
     
     ring.push_overwrite(42);
     CHECK(ring.size_approx() == 1);
@@ -118,8 +126,8 @@ TEST_CASE("[jjring][ovw] push_overwrite when buffer has space") {
     CHECK(value == 42);
 }
 
-TEST_CASE("[jjring][ovw] push_overwrite when buffer is full") {
-    jjring<int, 4> ring; // capacity = 3
+TEST_CASE_TEMPLATE("[jjring][ovw] push_overwrite when buffer is full", Policy, JJRING_POLICIES) {
+    jjring<int, 4, Policy> ring; // capacity = 3
     
     // Fill the buffer
     ring.push(1);
@@ -143,8 +151,8 @@ TEST_CASE("[jjring][ovw] push_overwrite when buffer is full") {
     CHECK(ring.empty() == true);
 }
 
-TEST_CASE("[jjring][clear] clear operation") {
-    jjring<int, 4> ring;
+TEST_CASE_TEMPLATE("[jjring][clear] clear operation", Policy, JJRING_POLICIES) {
+    jjring<int, 4, Policy> ring;
     
     // Add some elements
     ring.push(1);
@@ -159,8 +167,8 @@ TEST_CASE("[jjring][clear] clear operation") {
     CHECK(ring.size_approx() == 0);
 }
 
-TEST_CASE("[jjring][base][size] state methods accuracy") {
-    jjring<int, 4> ring; // capacity = 3
+TEST_CASE_TEMPLATE("[jjring][base][size] state methods accuracy", Policy, JJRING_POLICIES) {
+    jjring<int, 4, Policy> ring; // capacity = 3
     
     // Test progressive filling
     CHECK(ring.size_approx() == 0);
@@ -183,8 +191,8 @@ TEST_CASE("[jjring][base][size] state methods accuracy") {
     CHECK(ring.full() == true);
 }
 
-TEST_CASE("[jjring][zero_copy] write_acquire and write_commit") {
-    jjring<int, 8> ring; // capacity = 7
+TEST_CASE_TEMPLATE("[jjring][zero_copy] write_acquire and write_commit", Policy, JJRING_POLICIES) {
+    jjring<int, 8, Policy> ring; // capacity = 7
     
     int* write_ptr;
     size_t available = ring.write_acquire(&write_ptr);
@@ -206,8 +214,8 @@ TEST_CASE("[jjring][zero_copy] write_acquire and write_commit") {
     }
 }
 
-TEST_CASE("[jjring][zero_copy] read_acquire and read_commit") {
-    jjring<int, 8> ring; // capacity = 7
+TEST_CASE_TEMPLATE("[jjring][zero_copy] read_acquire and read_commit", Policy, JJRING_POLICIES) {
+    jjring<int, 8, Policy> ring; // capacity = 7
     
     // First push some data
     for (int i = 20; i < 25; ++i) {
@@ -228,8 +236,8 @@ TEST_CASE("[jjring][zero_copy] read_acquire and read_commit") {
     CHECK(ring.size_approx() == 5 - k);
 }
 
-TEST_CASE("[jjring][zero_copy] zero-copy operations when buffer is full") {
-    jjring<int, 4> ring; // capacity = 3
+TEST_CASE_TEMPLATE("[jjring][zero_copy] zero-copy operations when buffer is full", Policy, JJRING_POLICIES) {
+    jjring<int, 4, Policy> ring; // capacity = 3
     
     // Fill the buffer
     ring.push(1);
@@ -244,8 +252,8 @@ TEST_CASE("[jjring][zero_copy] zero-copy operations when buffer is full") {
     CHECK(write_ptr == nullptr);
 }
 
-TEST_CASE("[jjring][zero_copy] zero-copy operations when buffer is empty") {
-    jjring<int, 4> ring;
+TEST_CASE_TEMPLATE("[jjring][zero_copy] zero-copy operations when buffer is empty", Policy, JJRING_POLICIES) {
+    jjring<int, 4, Policy> ring;
     CHECK(ring.empty() == true);
     
     // Try read_acquire on empty buffer
@@ -255,8 +263,8 @@ TEST_CASE("[jjring][zero_copy] zero-copy operations when buffer is empty") {
     CHECK(read_ptr == nullptr);
 }
 
-TEST_CASE("[jjring][wrap] wraparound behavior") {
-    jjring<int, 4> ring; // capacity = 3
+TEST_CASE_TEMPLATE("[jjring][wrap] wraparound behavior", Policy, JJRING_POLICIES) {
+    jjring<int, 4, Policy> ring; // capacity = 3
     
     // Fill, empty, and fill again to test wraparound
     ring.push(1);
@@ -284,8 +292,8 @@ TEST_CASE("[jjring][wrap] wraparound behavior") {
     CHECK(value == 5);
 }
 
-TEST_CASE("[jjring][single] alternating push and pop operations") {
-    jjring<int, 4> ring; // capacity = 3
+TEST_CASE_TEMPLATE("[jjring][single] alternating push and pop operations", Policy, JJRING_POLICIES) {
+    jjring<int, 4, Policy> ring; // capacity = 3
     
     int value;
     
@@ -298,9 +306,9 @@ TEST_CASE("[jjring][single] alternating push and pop operations") {
     }
 }
 
-TEST_CASE("[jjring][types] with different data types") {
+TEST_CASE_TEMPLATE("[jjring][types] with different data types", Policy, JJRING_POLICIES) {
     SUBCASE("with double") {
-        jjring<double, 4> ring;
+        jjring<double, 4, Policy> ring;
         
         CHECK(ring.push(3.14) == true);
         CHECK(ring.push(2.71) == true);
@@ -323,7 +331,7 @@ TEST_CASE("[jjring][types] with different data types") {
 			}
 		};
 
-        jjring<TestStruct, 4> ring;
+        jjring<TestStruct, 4, Policy> ring;
 
         TestStruct input = {42, 100, 0.5f};
         CHECK(ring.push(input) == true);
@@ -334,7 +342,7 @@ TEST_CASE("[jjring][types] with different data types") {
     }
     
     SUBCASE("with array") {
-        jjring<std::array<int, 3>, 4> ring;
+        jjring<std::array<int, 3>, 4, Policy> ring;
         
         std::array<int, 3> input = {{1, 2, 3}};
         CHECK(ring.push(input) == true);
@@ -345,8 +353,8 @@ TEST_CASE("[jjring][types] with different data types") {
     }
 }
 
-TEST_CASE("[jjring][limits][N2] capacity_one edge behaviors") {
-    jjring<int, 2> ring; // capacity = 1
+TEST_CASE_TEMPLATE("[jjring][limits][N2] capacity_one edge behaviors", Policy, JJRING_POLICIES) {
+    jjring<int, 2, Policy> ring; // capacity = 1
     CHECK(ring.capacity() == 1);
     CHECK(ring.push(1) == true);
     CHECK(ring.full() == true);
@@ -364,8 +372,8 @@ TEST_CASE("[jjring][limits][N2] capacity_one edge behaviors") {
     CHECK(v == 4);
 }
 
-TEST_CASE("[jjring][bulk][wrap] push bulk splits across wrap") {
-    jjring<int, 8> ring; // capacity = 7
+TEST_CASE_TEMPLATE("[jjring][bulk][wrap] push bulk splits across wrap", Policy, JJRING_POLICIES) {
+    jjring<int, 8, Policy> ring; // capacity = 7
     std::vector<int> a = {1,2,3,4,5,6};
     CHECK(ring.push(a.data(), a.size()) == 6); // h=6
     int tmp;
@@ -380,8 +388,8 @@ TEST_CASE("[jjring][bulk][wrap] push bulk splits across wrap") {
     for (size_t i = 0; i < exp.size(); ++i) CHECK(out[i] == exp[i]);
 }
 
-TEST_CASE("[jjring][bulk][wrap] pop bulk splits across wrap") {
-    jjring<int, 8> ring; // capacity = 7
+TEST_CASE_TEMPLATE("[jjring][bulk][wrap] pop bulk splits across wrap", Policy, JJRING_POLICIES) {
+    jjring<int, 8, Policy> ring; // capacity = 7
     std::vector<int> a = {1,2,3,4,5,6};
     CHECK(ring.push(a.data(), a.size()) == 6); // h=6
     std::vector<int> scratch(5);
@@ -394,8 +402,8 @@ TEST_CASE("[jjring][bulk][wrap] pop bulk splits across wrap") {
     for (size_t i = 0; i < exp.size(); ++i) CHECK(out[i] == exp[i]);
 }
 
-TEST_CASE("[jjring][zero_copy][wrap] write_acquire wraps at end then restarts") {
-    jjring<int, 8> ring;
+TEST_CASE_TEMPLATE("[jjring][zero_copy][wrap] write_acquire wraps at end then restarts", Policy, JJRING_POLICIES) {
+    jjring<int, 8, Policy> ring;
     int init[7]; for (int i=0;i<7;++i) init[i]=i; // 0..6
     CHECK(ring.push(init, 7) == 7);
     int drop; CHECK(ring.pop(drop) == true); // remove 0 => t=1, h=7
@@ -410,8 +418,8 @@ TEST_CASE("[jjring][zero_copy][wrap] write_acquire wraps at end then restarts")
     for (size_t i = 0; i < exp.size(); ++i) CHECK(out[i] == exp[i]);
 }
 
-TEST_CASE("[jjring][zero_copy][wrap] read_acquire wraps at end then restarts") {
-    jjring<int, 8> ring;
+TEST_CASE_TEMPLATE("[jjring][zero_copy][wrap] read_acquire wraps at end then restarts", Policy, JJRING_POLICIES) {
+    jjring<int, 8, Policy> ring;
     for (int i=0;i<7;++i) CHECK(ring.push(i) == true); // 0..6
     int tmp;
     for (int i=0;i<6;++i) CHECK(ring.pop(tmp) == true); // leave {6}, t=6,h=7
@@ -431,8 +439,8 @@ TEST_CASE("[jjring][zero_copy][wrap] read_acquire wraps at end then restarts") {
     CHECK(ring.empty() == true);
 }
 
-TEST_CASE("[jjring][zero_copy] commit zero has no effect") {
-    jjring<int, 8> ring;
+TEST_CASE_TEMPLATE("[jjring][zero_copy] commit zero has no effect", Policy, JJRING_POLICIES) {
+    jjring<int, 8, Policy> ring;
     int* wp; size_t wn = ring.write_acquire(&wp);
     size_t s0 = ring.size_approx();
     ring.write_commit(0);
@@ -448,9 +456,9 @@ TEST_CASE("[jjring][zero_copy] commit zero has no effect") {
     CHECK(v == 123);
 }
 
-TEST_CASE("[jjring][types][align] strong alignment 32B") {
+TEST_CASE_TEMPLATE("[jjring][types][align] strong alignment 32B", Policy, JJRING_POLICIES) {
     struct alignas(32) S { unsigned char b[32]; };
-    jjring<S, 4> ring;
+    jjring<S, 4, Policy> ring;
     S s{}; CHECK(ring.push(s) == true);
     const S* rp; size_t n = ring.read_acquire(&rp);
     CHECK(n >= 1);
@@ -458,8 +466,8 @@ TEST_CASE("[jjring][types][align] strong alignment 32B") {
     ring.read_commit(1);
 }
 
-TEST_CASE("[jjring][bulk] zero sizes are no-ops") {
-    jjring<int, 8> ring;
+TEST_CASE_TEMPLATE("[jjring][bulk] zero sizes are no-ops", Policy, JJRING_POLICIES) {
+    jjring<int, 8, Policy> ring;
     int buf[3] = {1,2,3};
     CHECK(ring.push(buf, 0) == 0);
     CHECK(ring.size_approx() == 0);
@@ -467,8 +475,8 @@ TEST_CASE("[jjring][bulk] zero sizes are no-ops") {
     CHECK(ring.size_approx() == 0);
 }
 
-TEST_CASE("[jjring][base][size] size_approx bounds and flags") {
-    jjring<int, 4> ring; // cap=3
+TEST_CASE_TEMPLATE("[jjring][base][size] size_approx bounds and flags", Policy, JJRING_POLICIES) {
+    jjring<int, 4, Policy> ring; // cap=3
     CHECK(ring.size_approx() == 0);
     CHECK(ring.empty() == true);
     CHECK(ring.full() == false);
@@ -481,4 +489,273 @@ TEST_CASE("[jjring][base][size] size_approx bounds and flags") {
     CHECK((ring.empty() == (ring.size_approx()==0)));
 }
 
+TEST_CASE_TEMPLATE("[jjring][peek] peek reads without consuming", Policy, JJRING_POLICIES) {
+    jjring<int, 8, Policy> ring;
+    int v = -1;
+    CHECK(ring.peek(v) == false);
+    CHECK(ring.peek_at(0) == nullptr);
+
+    ring.push(10);
+    ring.push(11);
+    CHECK(ring.peek(v) == true);
+    CHECK(v == 10);
+    CHECK(ring.size_approx() == 2);
+    REQUIRE(ring.peek_at(1) != nullptr);
+    CHECK(*ring.peek_at(1) == 11);
+    CHECK(ring.peek_at(2) == nullptr);
+
+    CHECK(ring.pop(v) == true);
+    CHECK(v == 10);
+    CHECK(*ring.peek_at(0) == 11);
+}
+
+TEST_CASE_TEMPLATE("[jjring][peek][wrap] peek_n copies across the wrap point with an offset", Policy, JJRING_POLICIES) {
+    jjring<int, 8, Policy> ring; // capacity = 7
+    int scratch[6];
+    std::vector<int> a = {1,2,3,4,5,6};
+    CHECK(ring.push(a.data(), a.size()) == 6);
+    CHECK(ring.pop(scratch, 5) == 5); // t=5, left {6}
+    std::vector<int> b = {7,8,9,10,11};
+    CHECK(ring.push(b.data(), b.size()) == 5); // h=3, {6..11}
+
+    int out[8] = {};
+    CHECK(ring.peek_n(out, 8) == 6);
+    for (int i = 0; i < 6; ++i) CHECK(out[i] == 6 + i);
+    CHECK(ring.peek_n(out, 3, 2) == 3); // {8,9,10}, straddles the wrap point
+    CHECK(out[0] == 8);
+    CHECK(out[1] == 9);
+    CHECK(out[2] == 10);
+    CHECK(ring.peek_n(out, 8, 4) == 2);
+    CHECK(ring.peek_n(out, 8, 6) == 0);
+    CHECK(*ring.peek_at(3) == 9);
+    CHECK(ring.size_approx() == 6);
+}
+
+TEST_CASE_TEMPLATE("[jjring][zero_copy][wrap] read_acquire_all returns both segments", Policy, JJRING_POLICIES) {
+    jjring<int, 8, Policy> ring; // capacity = 7
+    jjring_span<const int> spans[2];
+    CHECK(ring.read_acquire_all(spans) == 0);
+    CHECK(spans[0].size == 0);
+    CHECK(spans[1].size == 0);
+
+    ring.push(1);
+    ring.push(2);
+    CHECK(ring.read_acquire_all(spans) == 2);
+    CHECK(spans[0].size == 2);
+    CHECK(spans[0].data[1] == 2);
+    CHECK(spans[1].size == 0);
+    CHECK(spans[1].data == nullptr);
+    ring.read_commit(2);
+
+    int a[6] = {3,4,5,6,7,8}; // t=h=2, wraps after 6
+    CHECK(ring.push(a, 6) == 6);
+    int scratch[3];
+    CHECK(ring.pop(scratch, 3) == 3); // t=5, {6,7,8}
+    int b[3] = {9,10,11};
+    CHECK(ring.push(b, 3) == 3);
+    CHECK(ring.read_acquire_all(spans) == 6);
+    REQUIRE(spans[0].size == 3);
+    REQUIRE(spans[1].size == 3);
+    for (int i = 0; i < 3; ++i) {
+        CHECK(spans[0].data[i] == 6 + i);
+        CHECK(spans[1].data[i] == 9 + i);
+    }
+    ring.read_commit(4); // commit across the wrap point
+    int v;
+    CHECK(ring.pop(v) == true);
+    CHECK(v == 10);
+}
+
+TEST_CASE_TEMPLATE("[jjring][peek] parser consumes length-prefixed frames in place", Policy, JJRING_POLICIES) {
+    jjring<uint8_t, 16, Policy> ring;
+    const uint8_t stream[] = {3, 'a', 'b', 'c', 1, 'd', 4, 'e', 'f'};
+    std::vector<std::vector<uint8_t>> frames;
+
+    const auto parse = [&] {
+        uint8_t len;
+        while (ring.peek(len) && ring.size_approx() >= size_t(1) + len) {
+            std::vector<uint8_t> frame(len);
+            CHECK(ring.peek_n(frame.data(), len, 1) == len);
+            ring.read_commit(1 + len);
+            frames.push_back(frame);
+        }
+    };
+    CHECK(ring.push(stream, 5) == 5);
+    parse(); // {3,a,b,c} complete, {1} header only
+    CHECK(frames.size() == 1);
+    CHECK(ring.size_approx() == 1);
+    CHECK(ring.push(stream + 5, 4) == 4);
+    parse(); // {1,d} complete, {4,e,f} incomplete
+    REQUIRE(frames.size() == 2);
+    CHECK(frames[0] == std::vector<uint8_t>({'a', 'b', 'c'}));
+    CHECK(frames[1] == std::vector<uint8_t>({'d'}));
+    CHECK(ring.size_approx() == 3);
+}
+
+TEST_CASE("[jjring][peek] runtime ring peeks untyped elements") {
+    alignas(int) int storage[4];
+    jjring_ ring(storage, 4, sizeof(int), alignof(int));
+    const int in[3] = {5, 6, 7};
+    CHECK(ring.push(in, 3) == 3);
+    int v = 0;
+    CHECK(ring.peek(&v) == true);
+    CHECK(v == 5);
+    CHECK(*static_cast<const int*>(ring.peek_at(2)) == 7);
+    int out[2];
+    CHECK(ring.peek_n(out, 2, 1) == 2);
+    CHECK(out[1] == 7);
+    jjring_span<const void> spans[2];
+    CHECK(ring.read_acquire_all(spans) == 3);
+    CHECK(ring.size_approx() == 3);
+}
+
+TEST_CASE("[jjring][footprint] index type is the narrowest one holding N") {
+    CHECK(std::is_same<jjring<uint8_t, 2>::index_type, uint8_t>::value);
+    CHECK(std::is_same<jjring<uint8_t, 256>::index_type, uint8_t>::value);
+    CHECK(std::is_same<jjring<uint8_t, 512>::index_type, uint16_t>::value);
+    CHECK(std::is_same<jjring<uint8_t, 65536>::index_type, uint16_t>::value);
+    CHECK(std::is_same<jjring<uint8_t, 131072>::index_type, uint32_t>::value);
+}
+
+TEST_CASE("[jjring][footprint] sizeof report") {
+    MESSAGE("sizeof(jjring<uint8_t, 16>) = " << sizeof(jjring<uint8_t, 16>));
+    MESSAGE("sizeof(jjring<uint8_t, 64>) = " << sizeof(jjring<uint8_t, 64>));
+    MESSAGE("sizeof(jjring<uint8_t, 1024>) = " << sizeof(jjring<uint8_t, 1024>));
+    MESSAGE("sizeof(jjring<uint32_t, 16>) = " << sizeof(jjring<uint32_t, 16>));
+    MESSAGE("sizeof(jjring_) = " << sizeof(jjring_));
+
+    // Only the storage and two indices, no stored mask, element size or buffer pointer
+    CHECK(sizeof(jjring<uint8_t, 16>) == 16 + 2);
+    CHECK(sizeof(jjring<uint8_t, 64>) == 64 + 2);
+    CHECK(sizeof(jjring<uint8_t, 256>) == 256 + 2);
+    CHECK(sizeof(jjring<uint8_t, 1024>) == 1024 + 4);
+    CHECK(sizeof(jjring<uint32_t, 16>) == 64 + 4);
+}
+
+TEST_CASE("[jjring][footprint][wrap] narrow indices wrap correctly") {
+    SUBCASE("8-bit indices") {
+        jjring<uint8_t, 256> ring;
+        uint8_t in[100], out[100];
+        uint8_t next_in = 0, next_out = 0;
+        for (int round = 0; round < 20; ++round) {
+            for (auto& v : in) v = next_in++;
+            CHECK(ring.push(in, 100) == 100);
+            CHECK(ring.size_approx() == 100);
+            CHECK(ring.pop(out, 100) == 100);
+            for (auto v : out) CHECK(v == next_out++);
+        }
+        for (int i = 0; i < 255; ++i) CHECK(ring.push(static_cast<uint8_t>(i)) == true);
+        CHECK(ring.full() == true);
+        CHECK(ring.size_approx() == 255);
+    }
+
+    SUBCASE("16-bit indices") {
+        jjring<uint16_t, 65536> ring;
+        std::vector<uint16_t> in(40000), out(40000);
+        uint16_t next_in = 0, next_out = 0;
+        for (int round = 0; round < 5; ++round) {
+            for (auto& v : in) v = next_in++;
+            CHECK(ring.push(in.data(), in.size()) == in.size());
+            CHECK(ring.size_approx() == in.size());
+            CHECK(ring.pop(out.data(), out.size()) == out.size());
+            bool ok = true;
+            for (auto v : out) ok = ok && v == next_out++;
+            CHECK(ok == true);
+        }
+    }
+}
+
+/**
+ * Set `jjring_stream_threshold` for the lifetime of the guard and restore the previous value afterwards.
+ */
+struct jjring_test_stream_threshold {
+    explicit jjring_test_stream_threshold(size_t threshold) : previous(jjring_stream_threshold.exchange(threshold)) {}
+    ~jjring_test_stream_threshold() { jjring_stream_threshold = previous; }
+    jjring_test_stream_threshold(const jjring_test_stream_threshold&) = delete;
+    jjring_test_stream_threshold& operator=(const jjring_test_stream_threshold&) = delete;
+    const size_t previous;
+};
+
+template <size_t Size>
+struct jjring_test_frame {
+    uint8_t b[Size];
+};
+
+TEST_CASE_TEMPLATE("[jjring][bulk][stream] large elements round-trip through streaming and prefetching copies", Policy, JJRING_POLICIES) {
+    using frame = jjring_test_frame<1027>; // odd size, unaligned slots
+    jjring_test_stream_threshold threshold(1024);
+    std::unique_ptr<jjring<frame, 8, Policy>> ring(new jjring<frame, 8, Policy>());
+    std::vector<frame> in(7), out(7);
+    for (size_t i = 0; i < in.size(); ++i) {
+        for (size_t k = 0; k < sizeof(frame); ++k) in[i].b[k] = static_cast<uint8_t>(i * 31 + k);
+    }
+    for (int round = 0; round < 3; ++round) {
+        CHECK(ring->push(in.data(), 5) == 5); // wraps on later rounds
+        frame single;
+        CHECK(ring->pop(single) == true);
+        CHECK(std::memcmp(&single, &in[0], sizeof(frame)) == 0);
+        CHECK(ring->pop(out.data(), 7) == 4);
+        for (size_t i = 0; i < 4; ++i) {
+            CHECK(std::memcmp(&out[i], &in[i + 1], sizeof(frame)) == 0);
+        }
+    }
+    CHECK(ring->empty() == true);
+}
+
+TEST_CASE("[jjring][stream] streaming copy handles every alignment and length") {
+    std::vector<uint8_t> src(300), dst(320);
+    for (size_t i = 0; i < src.size(); ++i) src[i] = static_cast<uint8_t>(i * 7 + 1);
+    for (size_t offset = 0; offset < 16; ++offset) {
+        for (size_t size = 0; size < 200; size += 13) {
+            std::fill(dst.begin(), dst.end(), 0);
+            jjring_copy_stream(dst.data() + offset, src.data(), size);
+            jjring_stream_fence();
+            CHECK(std::memcmp(dst.data() + offset, src.data(), size) == 0);
+            CHECK(dst[offset + size] == 0);
+        }
+    }
+}
+
+template <size_t Size>
+static void jjring_bench_frames() {
+    using frame = jjring_test_frame<Size>;
+    using ring_t = jjring<frame, 64>;
+    constexpr size_t total = (size_t(64) << 20) / Size; // 64 MB per run
+    constexpr size_t batch = 8;
+    std::unique_ptr<ring_t> ring(new ring_t());
+    std::vector<frame> in(batch), out(batch);
+
+    const auto run = [&](size_t threshold) {
+        jjring_test_stream_threshold guard(threshold);
+        const auto start = std::chrono::steady_clock::now();
+        std::thread consumer([&] {
+            for (size_t n = 0; n < total;) {
+                const auto k = ring->pop(out.data(), batch);
+                if (k == 0) std::this_thread::yield();
+                n += k;
+            }
+        });
+        for (size_t n = 0; n < total;) {
+            const auto k = ring->push(in.data(), std::min(batch, total - n));
+            if (k == 0) std::this_thread::yield();
+            n += k;
+        }
+        consumer.join();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return double(total * Size) / (1 << 20) / elapsed.count();
+    };
+    const auto plain = run(0);
+    const auto stream = run(Size);
+    MESSAGE(Size << " B frames: plain " << plain << " MB/s, streaming " << stream << " MB/s");
+}
+
+TEST_CASE("[jjring][bench] streaming and plain bulk copy throughput by element size" * doctest::skip()) {
+    MESSAGE("Producer and consumer threads on " << std::thread::hardware_concurrency() << " hardware threads");
+    jjring_bench_frames<256>();
+    jjring_bench_frames<512>();
+    jjring_bench_frames<1024>();
+    jjring_bench_frames<2048>();
+    jjring_bench_frames<4096>();
+}
+
 TEST_SUITE_END();
@@ -0,0 +1,191 @@
+#pragma once
+#include "jjring.hpp"
+#include <cerrno>
+#include <cstdint>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/**
+ * @file
+ * Vectored I/O between file descriptors and `jjring`s, with a single system call per transfer even when the data wraps around the end of the buffer.
+ */
+
+/**
+ * Read from a file descriptor into the free space of the ring, with a single `readv` call.
+ * @return The number of bytes read, 0 at end of file, or -1 on error with `errno` set. When the ring is full, nothing is read and -1 is returned with `errno` set to `ENOBUFS`.
+ * @note This is a producer-side operation.
+ */
+template <typename T, size_t N, typename Policy>
+ssize_t jjring_readv(int fd, jjring<T, N, Policy>& ring) noexcept {
+	static_assert(sizeof(T) == 1, "jjring_readv needs a byte ring");
+	jjring_span<T> spans[2];
+	if(ring.write_acquire_all(spans) == 0) {
+		errno = ENOBUFS;
+		return -1;
+	}
+	const struct iovec iov[2] = {
+		{static_cast<void*>(spans[0].data), spans[0].size},
+		{static_cast<void*>(spans[1].data), spans[1].size},
+	};
+	const auto n = readv(fd, iov, spans[1].size? 2 : 1);
+	if(n > 0) {
+		ring.write_commit(static_cast<size_t>(n));
+	}
+	return n;
+}
+
+/**
+ * Write the contents of the ring to a file descriptor, with a single `writev` call.
+ * @return The number of bytes written, which are removed from the ring, or -1 on error with `errno` set. When the ring is empty, nothing is written and 0 is returned.
+ * @note This is a consumer-side operation.
+ */
+template <typename T, size_t N, typename Policy>
+ssize_t jjring_writev(int fd, jjring<T, N, Policy>& ring) noexcept {
+	static_assert(sizeof(T) == 1, "jjring_writev needs a byte ring");
+	jjring_span<const T> spans[2];
+	if(ring.read_acquire_all(spans) == 0) {
+		return 0;
+	}
+	const struct iovec iov[2] = {
+		{const_cast<void*>(static_cast<const void*>(spans[0].data)), spans[0].size},
+		{const_cast<void*>(static_cast<const void*>(spans[1].data)), spans[1].size},
+	};
+	const auto n = writev(fd, iov, spans[1].size? 2 : 1);
+	if(n > 0) {
+		ring.read_commit(static_cast<size_t>(n));
+	}
+	return n;
+}
+
+/**
+ * The header preceding the elements of a ring saved with `jjring_save()`.
+ * @note Fields are stored in host byte order: snapshots are meant to be restored on the same machine.
+ */
+struct jjring_file_header {
+	static constexpr uint32_t magic_value = 0x47524A4A; // "JJRG"
+
+	uint32_t magic;
+	uint32_t element_size;
+	/**
+	 * The capacity of the saved ring, for information only: snapshots can be loaded into rings of any capacity that fits `count`.
+	 */
+	uint64_t capacity;
+	uint64_t count;
+	uint32_t checksum;
+	uint32_t reserved;
+};
+
+/**
+ * @return The FNV-1a hash of the given data, continuing from `hash`.
+ */
+inline uint32_t jjring_checksum(const void* data, size_t size, uint32_t hash = 0x811C9DC5) noexcept {
+	const auto p = static_cast<const uint8_t*>(data);
+	for(size_t i=0; i<size; ++i) {
+		hash = (hash ^ p[i]) * 0x01000193;
+	}
+	return hash;
+}
+
+/**
+ * Transfer the given buffers with `readv` or `writev`, retrying after short transfers.
+ * @return The number of bytes transferred, which is less than the total size only at end of file, or -1 on error.
+ */
+template <typename Fn>
+ssize_t jjring_transfer_(Fn&& fn, int fd, struct iovec* iov, int count) noexcept {
+	ssize_t total = 0;
+	while(count > 0) {
+		const auto n = fn(fd, iov, count);
+		if(n < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		if(n == 0) {
+			break;
+		}
+		total += n;
+		// Skip the fully transferred buffers, and advance into the partially transferred one
+		auto left = static_cast<size_t>(n);
+		while(count > 0 && left >= iov->iov_len) {
+			left -= iov->iov_len;
+			++iov;
+			--count;
+		}
+		if(count > 0) {
+			iov->iov_base = static_cast<char*>(iov->iov_base) + left;
+			iov->iov_len -= left;
+		}
+	}
+	return total;
+}
+
+/**
+ * Save the elements currently in the ring to a file descriptor, as a header followed by the elements, in one sequential `writev`.
+ * The elements are left in the ring.
+ * @return true if the snapshot was written completely.
+ * @note This is a consumer-side operation. Elements pushed concurrently may or may not be part of the snapshot.
+ */
+template <typename T, size_t N, typename Policy>
+bool jjring_save(int fd, jjring<T, N, Policy>& ring) noexcept {
+	jjring_span<const T> spans[2];
+	const auto count = ring.read_acquire_all(spans);
+
+	jjring_file_header header = {jjring_file_header::magic_value, sizeof(T), N, count, 0, 0};
+	auto checksum = jjring_checksum(&header, sizeof(header));
+	checksum = jjring_checksum(spans[0].data, spans[0].size * sizeof(T), checksum);
+	checksum = jjring_checksum(spans[1].data, spans[1].size * sizeof(T), checksum);
+	header.checksum = checksum;
+
+	struct iovec iov[3] = {
+		{static_cast<void*>(&header), sizeof(header)},
+		{const_cast<void*>(static_cast<const void*>(spans[0].data)), spans[0].size * sizeof(T)},
+		{const_cast<void*>(static_cast<const void*>(spans[1].data)), spans[1].size * sizeof(T)},
+	};
+	const auto size = sizeof(header) + count * sizeof(T);
+	return jjring_transfer_(writev, fd, iov, 3) == static_cast<ssize_t>(size);
+}
+
+/**
+ * Restore elements saved with `jjring_save()` from a file descriptor, reading the header, then exactly the saved elements directly into the ring in one sequential `readv`.
+ * Nothing past the snapshot is consumed, so snapshots can follow each other in a file or stream, and a pipe or socket does not need to be closed by the writer.
+ * The ring is cleared first. The snapshot may come from a ring of a different capacity, as long as its elements fit.
+ * @return true if a valid snapshot was restored, false otherwise, in which case the ring is left empty.
+ * @warning This operation is not thread-safe and should only be called when the buffer is not being accessed by other threads.
+ */
+template <typename T, size_t N, typename Policy>
+bool jjring_load(int fd, jjring<T, N, Policy>& ring) noexcept {
+	ring.clear();
+	jjring_file_header header;
+	struct iovec hiov = {static_cast<void*>(&header), sizeof(header)};
+	if(jjring_transfer_(readv, fd, &hiov, 1) != static_cast<ssize_t>(sizeof(header))) {
+		return false;
+	}
+	if(header.magic != jjring_file_header::magic_value || header.element_size != sizeof(T) || header.count > ring.capacity()) {
+		return false;
+	}
+	const auto count = static_cast<size_t>(header.count);
+
+	// The ring is empty, so the elements start at the beginning of the first span
+	jjring_span<T> spans[2];
+	ring.write_acquire_all(spans);
+	const auto c1 = (count < spans[0].size)? count : spans[0].size;
+	struct iovec iov[2] = {
+		{static_cast<void*>(spans[0].data), c1 * sizeof(T)},
+		{static_cast<void*>(spans[1].data), (count - c1) * sizeof(T)},
+	};
+	if(jjring_transfer_(readv, fd, iov, (count > c1)? 2 : 1) != static_cast<ssize_t>(count * sizeof(T))) {
+		return false;
+	}
+
+	const auto checksum = header.checksum;
+	header.checksum = 0;
+	auto calc = jjring_checksum(&header, sizeof(header));
+	calc = jjring_checksum(spans[0].data, c1 * sizeof(T), calc);
+	calc = jjring_checksum(spans[1].data, (count - c1) * sizeof(T), calc);
+	if(calc != checksum) {
+		return false;
+	}
+	ring.write_commit(count);
+	return true;
+}
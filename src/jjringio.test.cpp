@@ -0,0 +1,269 @@
+#include "../ext/doctest.h"
+#include "test.hpp"
+#include "jjringio.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+TEST_SUITE_BEGIN("jjringio");
+
+struct jjringio_pipe_t {
+	int fd[2];
+
+	jjringio_pipe_t() {
+		REQUIRE(pipe(fd) == 0);
+	}
+	~jjringio_pipe_t() {
+		close_end(0);
+		close_end(1);
+	}
+	void close_end(int i) {
+		if(fd[i] >= 0) {
+			close(fd[i]);
+			fd[i] = -1;
+		}
+	}
+};
+
+struct jjringio_file_t {
+	test_file_t file;
+	int fd;
+
+	jjringio_file_t() : fd(open(file.path.c_str(), O_RDWR)) {
+		REQUIRE(fd >= 0);
+	}
+	~jjringio_file_t() {
+		close(fd);
+	}
+	void rewind() {
+		REQUIRE(lseek(fd, 0, SEEK_SET) == 0);
+	}
+};
+
+TEST_CASE("[jjring][zero_copy][wrap] write_acquire_all returns both free segments") {
+	jjring<int, 8> ring; // capacity = 7
+	jjring_span<int> spans[2];
+	CHECK(ring.write_acquire_all(spans) == 7);
+	CHECK(spans[0].size == 7);
+	CHECK(spans[1].size == 0);
+	CHECK(spans[1].data == nullptr);
+
+	int a[5] = {1,2,3,4,5};
+	CHECK(ring.push(a, 5) == 5);
+	int scratch[4];
+	CHECK(ring.pop(scratch, 4) == 4); // t=4, h=5, {5}
+	CHECK(ring.write_acquire_all(spans) == 6);
+	REQUIRE(spans[0].size == 3);
+	REQUIRE(spans[1].size == 3);
+	for(int i=0; i<6; ++i) {
+		(i < 3? spans[0].data[i] : spans[1].data[i - 3]) = 6 + i;
+	}
+	ring.write_commit(6); // commit across the wrap point
+	CHECK(ring.full() == true);
+	int out[7];
+	CHECK(ring.pop(out, 7) == 7);
+	for(int i=0; i<7; ++i) {
+		CHECK(out[i] == 5 + i);
+	}
+
+	CHECK(ring.push(a, 5) == 5);
+	CHECK(ring.pop(scratch, 1) == 1);
+	CHECK(ring.push(a, 3) == 3);
+	CHECK(ring.full() == true);
+	CHECK(ring.write_acquire_all(spans) == 0);
+	CHECK(spans[0].data == nullptr);
+}
+
+TEST_CASE("[jjringio] readv fills both segments in one call") {
+	jjringio_pipe_t p;
+	jjring<uint8_t, 16> ring; // capacity = 15
+	uint8_t scratch[12];
+	CHECK(ring.push(scratch, 12) == 12);
+	CHECK(ring.pop(scratch, 12) == 12); // t=h=12, 4 bytes until wrap
+
+	const char msg[] = "0123456789";
+	REQUIRE(write(p.fd[1], msg, 10) == 10);
+	CHECK(jjring_readv(p.fd[0], ring) == 10);
+	CHECK(ring.size_approx() == 10);
+	uint8_t out[16];
+	CHECK(ring.pop(out, 16) == 10);
+	CHECK(std::memcmp(out, msg, 10) == 0);
+}
+
+TEST_CASE("[jjringio] readv reports a full ring and end of file") {
+	jjringio_pipe_t p;
+	jjring<uint8_t, 4> ring; // capacity = 3
+	REQUIRE(write(p.fd[1], "abcdef", 6) == 6);
+	CHECK(jjring_readv(p.fd[0], ring) == 3);
+	CHECK(jjring_readv(p.fd[0], ring) == -1);
+	CHECK(errno == ENOBUFS);
+
+	ring.clear();
+	CHECK(jjring_readv(p.fd[0], ring) == 3);
+	ring.clear();
+	p.close_end(1);
+	CHECK(jjring_readv(p.fd[0], ring) == 0);
+	CHECK(ring.empty() == true);
+}
+
+TEST_CASE("[jjringio] writev drains both segments in one call") {
+	jjringio_pipe_t p;
+	jjring<uint8_t, 16> ring;
+	CHECK(jjring_writev(p.fd[1], ring) == 0);
+
+	uint8_t scratch[13];
+	CHECK(ring.push(scratch, 13) == 13);
+	CHECK(ring.pop(scratch, 13) == 13); // t=h=13
+	const uint8_t msg[] = {'h', 'e', 'l', 'l', 'o', ' ', 'r', 'i', 'n', 'g'};
+	CHECK(ring.push(msg, 10) == 10); // wraps after 3
+
+	CHECK(jjring_writev(p.fd[1], ring) == 10);
+	CHECK(ring.empty() == true);
+	uint8_t out[10];
+	REQUIRE(read(p.fd[0], out, 10) == 10);
+	CHECK(std::memcmp(out, msg, 10) == 0);
+}
+
+TEST_CASE("[jjringio] bridges two descriptors through a ring") {
+	jjringio_pipe_t in, out;
+	jjring<uint8_t, 8> ring; // capacity = 7
+	uint8_t sent[100], received[100];
+	for(size_t i=0; i<sizeof(sent); ++i) {
+		sent[i] = static_cast<uint8_t>(i * 13);
+	}
+	REQUIRE(write(in.fd[1], sent, sizeof(sent)) == ssize_t(sizeof(sent)));
+
+	size_t total = 0;
+	while(total < sizeof(sent)) {
+		REQUIRE(jjring_readv(in.fd[0], ring) > 0);
+		const auto n = jjring_writev(out.fd[1], ring);
+		REQUIRE(n > 0);
+		REQUIRE(read(out.fd[0], received + total, static_cast<size_t>(n)) == n);
+		total += static_cast<size_t>(n);
+	}
+	CHECK(std::memcmp(sent, received, sizeof(sent)) == 0);
+}
+
+TEST_CASE("[jjringio][persist][wrap] save and load restore the elements in order") {
+	jjringio_file_t file;
+	jjring<uint32_t, 8> ring; // capacity = 7
+	uint32_t in[7] = {10, 11, 12, 13, 14, 15, 16};
+	uint32_t scratch[5];
+	CHECK(ring.push(in, 5) == 5);
+	CHECK(ring.pop(scratch, 5) == 5); // t=h=5
+	CHECK(ring.push(in, 6) == 6); // wraps after 3
+
+	CHECK(jjring_save(file.fd, ring) == true);
+	CHECK(ring.size_approx() == 6);
+	CHECK(lseek(file.fd, 0, SEEK_END) == off_t(sizeof(jjring_file_header) + 6 * sizeof(uint32_t)));
+
+	// The snapshot can be restored into a ring of a different capacity
+	file.rewind();
+	jjring<uint32_t, 16> restored;
+	restored.push(99u);
+	CHECK(jjring_load(file.fd, restored) == true);
+	uint32_t out[16];
+	CHECK(restored.pop(out, 16) == 6);
+	for(size_t i=0; i<6; ++i) {
+		CHECK(out[i] == in[i]);
+	}
+}
+
+TEST_CASE("[jjringio][persist] empty rings round-trip") {
+	jjringio_file_t file;
+	jjring<uint16_t, 4> ring;
+	CHECK(jjring_save(file.fd, ring) == true);
+	file.rewind();
+	ring.push(uint16_t(1));
+	CHECK(jjring_load(file.fd, ring) == true);
+	CHECK(ring.empty() == true);
+}
+
+TEST_CASE("[jjringio][persist] consecutive snapshots load one at a time") {
+	jjringio_file_t file;
+	jjring<uint32_t, 8> ring;
+	uint32_t a[3] = {1, 2, 3};
+	uint32_t b[2] = {4, 5};
+	ring.push(a, 3);
+	REQUIRE(jjring_save(file.fd, ring));
+	ring.clear();
+	ring.push(b, 2);
+	REQUIRE(jjring_save(file.fd, ring));
+	file.rewind();
+
+	jjring<uint32_t, 16> restored; // Larger than both snapshots
+	uint32_t out[16];
+	CHECK(jjring_load(file.fd, restored) == true);
+	CHECK(restored.pop(out, 16) == 3);
+	CHECK(out[2] == 3);
+	CHECK(jjring_load(file.fd, restored) == true);
+	CHECK(restored.pop(out, 16) == 2);
+	CHECK(out[0] == 4);
+	CHECK(out[1] == 5);
+	CHECK(jjring_load(file.fd, restored) == false);
+}
+
+TEST_CASE("[jjringio][persist] load from a pipe whose writer stays open") {
+	jjringio_pipe_t p;
+	jjring<uint32_t, 8> ring;
+	uint32_t in[4] = {7, 8, 9, 10};
+	ring.push(in, 4);
+	REQUIRE(jjring_save(p.fd[1], ring));
+
+	// Returns as soon as the snapshot is read, without waiting for end of file
+	jjring<uint32_t, 32> restored;
+	CHECK(jjring_load(p.fd[0], restored) == true);
+	uint32_t out[32];
+	CHECK(restored.pop(out, 32) == 4);
+	CHECK(out[3] == 10);
+}
+
+TEST_CASE("[jjringio][persist] load rejects invalid snapshots") {
+	jjring<uint32_t, 8> ring;
+	uint32_t in[5] = {1, 2, 3, 4, 5};
+	ring.push(in, 5);
+
+	SUBCASE("corrupted element") {
+		jjringio_file_t file;
+		REQUIRE(jjring_save(file.fd, ring));
+		const uint32_t bad = 42;
+		REQUIRE(pwrite(file.fd, &bad, sizeof(bad), sizeof(jjring_file_header) + 2 * sizeof(uint32_t)) == ssize_t(sizeof(bad)));
+		file.rewind();
+		jjring<uint32_t, 8> restored;
+		CHECK(jjring_load(file.fd, restored) == false);
+		CHECK(restored.empty() == true);
+	}
+	SUBCASE("truncated file") {
+		jjringio_file_t file;
+		REQUIRE(jjring_save(file.fd, ring));
+		REQUIRE(ftruncate(file.fd, sizeof(jjring_file_header) + 4 * sizeof(uint32_t)) == 0);
+		file.rewind();
+		jjring<uint32_t, 8> restored;
+		CHECK(jjring_load(file.fd, restored) == false);
+	}
+	SUBCASE("element size mismatch") {
+		jjringio_file_t file;
+		REQUIRE(jjring_save(file.fd, ring));
+		file.rewind();
+		jjring<uint16_t, 16> restored;
+		CHECK(jjring_load(file.fd, restored) == false);
+	}
+	SUBCASE("too many elements") {
+		jjringio_file_t file;
+		REQUIRE(jjring_save(file.fd, ring));
+		file.rewind();
+		jjring<uint32_t, 4> restored; // capacity = 3
+		CHECK(jjring_load(file.fd, restored) == false);
+		CHECK(restored.empty() == true);
+	}
+	SUBCASE("empty file") {
+		jjringio_file_t file;
+		jjring<uint32_t, 8> restored;
+		CHECK(jjring_load(file.fd, restored) == false);
+	}
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,61 @@
+#include "jjspillring.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+jjspillring_::~jjspillring_() {
+	close();
+}
+
+bool jjspillring_::open(const char* path, size_t capacity_bytes, size_t element_size, size_t alignment) noexcept {
+	close();
+
+	// The spill ring needs a power of 2 number of elements, with at least one usable slot
+	size_t capacity = 1;
+	while(capacity * 2 <= capacity_bytes / element_size) {
+		capacity *= 2;
+	}
+	if(capacity < 2) {
+		return false;
+	}
+	const auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	const auto size = (capacity * element_size + page - 1) / page * page;
+
+	const int f = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if(f < 0) {
+		return false;
+	}
+	// Reserve the blocks up front, so that a full disk cannot fault the producer in the middle of a write
+#if defined(__linux__)
+	if(posix_fallocate(f, 0, static_cast<off_t>(size)) != 0 && ftruncate(f, static_cast<off_t>(size)) != 0) {
+#else
+	if(ftruncate(f, static_cast<off_t>(size)) != 0) {
+#endif
+		::close(f);
+		return false;
+	}
+	void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, f, 0);
+	if(p == MAP_FAILED) {
+		::close(f);
+		return false;
+	}
+	// Elements are written and read back in order, let the kernel write back and read ahead in large chunks
+	madvise(p, size, MADV_SEQUENTIAL);
+
+	fd = f;
+	map = p;
+	map_size = size;
+	new(storage) jjring_(map, capacity, element_size, alignment);
+	return true;
+}
+
+void jjspillring_::close() noexcept {
+	if(map == nullptr) {
+		return;
+	}
+	munmap(map, map_size);
+	::close(fd);
+	map = nullptr;
+	map_size = 0;
+	fd = -1;
+}
@@ -0,0 +1,177 @@
+#pragma once
+#include "jjring.hpp"
+#include <cstddef>
+#include <new>
+
+/**
+ * Private implementation details for the spill ring buffer.
+ * @see jjspillring
+ */
+class jjspillring_ {
+public:
+	jjspillring_() noexcept {}
+	~jjspillring_();
+	jjspillring_(const jjspillring_&) = delete;
+	jjspillring_& operator=(const jjspillring_&) = delete;
+
+	/**
+	 * @param path Path of the spill file, which is created or truncated.
+	 * @param capacity_bytes Maximum size of the spill file, in bytes.
+	 * @param element_size Size of each element.
+	 * @param alignment Alignment requirement for the elements.
+	 */
+	bool open(const char* path, size_t capacity_bytes, size_t element_size, size_t alignment) noexcept;
+	void close() noexcept;
+	bool is_open() const noexcept {
+		return map != nullptr;
+	}
+	/**
+	 * @return The spill ring, which must only be used when the spill file is open.
+	 */
+	jjring_& ring() noexcept {
+		return *reinterpret_cast<jjring_*>(storage);
+	}
+	const jjring_& ring() const noexcept {
+		return *reinterpret_cast<const jjring_*>(storage);
+	}
+private:
+	alignas(jjring_) unsigned char storage[sizeof(jjring_)];
+	void* map = nullptr;
+	size_t map_size = 0;
+	int fd = -1;
+};
+
+/**
+ * A lock-free single-producer, single-consumer ring buffer with fixed 2^N capacity in memory, which overflows into a memory-mapped spill file.
+ *
+ * While the in-memory ring is full, or as long as spilled elements have not been consumed, the producer appends elements to the spill file.
+ * The consumer drains the in-memory ring, then the spill file, so that FIFO order is preserved across both.
+ * Without an open spill file, it behaves like `jjring`.
+ * @note The spill file is a scratch area: its contents are not meant to be read back after `close()`.
+ * @note Zero-copy operations are not available, since elements may live in either storage.
+ */
+template <typename T, size_t N>
+class jjspillring {
+public:
+	using value_type = T;
+public:
+	/**
+	 * Open the spill file.
+	 * @param path Path of the spill file, which is created or truncated.
+	 * @param capacity_bytes Maximum size of the spill file, in bytes. It is rounded down so that it holds a power of 2 number of elements.
+	 * @return true if the spill file was created and mapped successfully.
+	 * @warning This operation is not thread-safe and should only be called when the buffer is not being accessed by other threads.
+	 */
+	bool open(const char* path, size_t capacity_bytes) noexcept {
+		return spill.open(path, capacity_bytes, sizeof(T), alignof(T));
+	}
+	/**
+	 * Close the spill file, dropping any element left in it.
+	 * @warning This operation is not thread-safe and should only be called when the buffer is not being accessed by other threads.
+	 */
+	void close() noexcept {
+		spill.close();
+	}
+	/**
+	 * @return true if a spill file is open.
+	 */
+	bool is_open() const noexcept {
+		return spill.is_open();
+	}
+
+	/**
+	 * Clear the ring buffer and the spill file.
+	 * @warning This operation is not thread-safe and should only be called when the buffer is not being accessed by other threads.
+	 */
+	void clear() noexcept {
+		ring.clear();
+		if(spill.is_open()) {
+			spill.ring().clear();
+		}
+	}
+	/**
+	 * @return true if both the in-memory ring and the spill file are empty.
+	 */
+	bool empty() const noexcept {
+		return ring.empty() && spilled_approx() == 0;
+	}
+	/**
+	 * @return The approximate number of elements in the buffer, including spilled ones.
+	 */
+	size_t size_approx() const noexcept {
+		return ring.size_approx() + spilled_approx();
+	}
+	/**
+	 * @return The approximate number of elements waiting in the spill file.
+	 */
+	size_t spilled_approx() const noexcept {
+		return spill.is_open()? spill.ring().size_approx() : 0;
+	}
+
+	/**
+	 * Push an element into the buffer, spilling it to the file if needed.
+	 * @param item The element to push.
+	 * @return true if the element was pushed successfully, false if both the ring and the spill file are full.
+	 */
+	bool push(const T& item) noexcept {
+		if(spilled_approx() == 0 && ring.push(item)) {
+			return true;
+		}
+		return spill.is_open() && spill.ring().push(&item);
+	}
+	/**
+	 * Push multiple elements into the buffer at once, spilling the remainder to the file as a single sequential write.
+	 * @param src Pointer to the first element to push.
+	 * @param size The number of elements to push.
+	 * @return The number of elements successfully pushed.
+	 */
+	size_t push(const T* src, size_t size) noexcept {
+		size_t n = 0;
+		if(spilled_approx() == 0) {
+			n = ring.push(src, size);
+		}
+		if(n < size && spill.is_open()) {
+			n += spill.ring().push(static_cast<const void*>(src + n), size - n);
+		}
+		return n;
+	}
+	/**
+	 * Pop an element from the buffer.
+	 * @param item The element to pop.
+	 * @return true if the element was popped successfully, false if the buffer is empty.
+	 */
+	bool pop(T& item) noexcept {
+		if(ring.pop(item)) {
+			return true;
+		}
+		if(spilled_approx() == 0) {
+			return false;
+		}
+		// Elements pushed in memory before the spilled ones are now visible, and must go first
+		if(ring.pop(item)) {
+			return true;
+		}
+		return spill.ring().pop(&item);
+	}
+	/**
+	 * Pop multiple elements from the buffer.
+	 * @param dst Pointer to the destination buffer.
+	 * @param size The number of elements to pop.
+	 * @return The number of elements successfully popped.
+	 */
+	size_t pop(T* dst, size_t size) noexcept {
+		size_t n = ring.pop(dst, size);
+		while(n < size && spilled_approx() != 0) {
+			const auto k = ring.pop(dst + n, size - n);
+			if(k > 0) {
+				n += k;
+				continue;
+			}
+			n += spill.ring().pop(static_cast<void*>(dst + n), size - n);
+		}
+		return n;
+	}
+private:
+	jjring<T, N> ring;
+	jjspillring_ spill;
+};
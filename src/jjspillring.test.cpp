@@ -0,0 +1,160 @@
+#include "../ext/doctest.h"
+#include "test.hpp"
+#include "jjspillring.hpp"
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+TEST_SUITE_BEGIN("jjspillring");
+
+TEST_CASE("[jjspillring][base] behaves like jjring without spill file") {
+	jjspillring<int, 4> ring; // capacity = 3
+	CHECK(ring.is_open() == false);
+	CHECK(ring.push(1) == true);
+	CHECK(ring.push(2) == true);
+	CHECK(ring.push(3) == true);
+	CHECK(ring.push(4) == false);
+	CHECK(ring.spilled_approx() == 0);
+	int v;
+	CHECK(ring.pop(v) == true);
+	CHECK(v == 1);
+	CHECK(ring.size_approx() == 2);
+}
+
+TEST_CASE("[jjspillring][base] open rejects files too small for two elements") {
+	test_file_t file;
+	jjspillring<int, 4> ring;
+	CHECK(ring.open(file.path.c_str(), sizeof(int)) == false);
+	CHECK(ring.is_open() == false);
+	CHECK(ring.open(file.path.c_str(), 2 * sizeof(int)) == true);
+	CHECK(ring.is_open() == true);
+}
+
+TEST_CASE("[jjspillring][single] overflow spills and preserves FIFO order") {
+	test_file_t file;
+	jjspillring<int, 4> ring; // capacity = 3
+	REQUIRE(ring.open(file.path.c_str(), 64 * sizeof(int)));
+
+	for(int i=0; i<10; ++i) {
+		CHECK(ring.push(i) == true);
+	}
+	CHECK(ring.spilled_approx() == 7);
+	CHECK(ring.size_approx() == 10);
+
+	int v;
+	CHECK(ring.pop(v) == true);
+	CHECK(v == 0);
+	// The ring has room again, but pushes keep going to the spill file while it is not drained
+	CHECK(ring.push(10) == true);
+	CHECK(ring.spilled_approx() == 8);
+
+	for(int i=1; i<=10; ++i) {
+		CHECK(ring.pop(v) == true);
+		CHECK(v == i);
+	}
+	CHECK(ring.pop(v) == false);
+	CHECK(ring.empty() == true);
+
+	// Once drained, the in-memory ring is used again
+	CHECK(ring.push(11) == true);
+	CHECK(ring.spilled_approx() == 0);
+	CHECK(ring.pop(v) == true);
+	CHECK(v == 11);
+}
+
+TEST_CASE("[jjspillring][bulk] bulk push spills remainder and bulk pop drains both") {
+	test_file_t file;
+	jjspillring<int, 8> ring; // capacity = 7
+	REQUIRE(ring.open(file.path.c_str(), 64 * sizeof(int)));
+
+	std::vector<int> in(20);
+	for(size_t i=0; i<in.size(); ++i) {
+		in[i] = static_cast<int>(i);
+	}
+	CHECK(ring.push(in.data(), in.size()) == 20);
+	CHECK(ring.spilled_approx() == 13);
+
+	std::vector<int> out(25);
+	CHECK(ring.pop(out.data(), out.size()) == 20);
+	for(size_t i=0; i<in.size(); ++i) {
+		CHECK(out[i] == in[i]);
+	}
+	CHECK(ring.empty() == true);
+}
+
+TEST_CASE("[jjspillring][limits] push fails once the spill file is full") {
+	test_file_t file;
+	jjspillring<int, 4> ring; // capacity = 3
+	REQUIRE(ring.open(file.path.c_str(), 4 * sizeof(int))); // spill capacity = 3
+
+	std::vector<int> in = {1, 2, 3, 4, 5, 6, 7, 8};
+	CHECK(ring.push(in.data(), in.size()) == 6);
+	CHECK(ring.push(9) == false);
+	CHECK(ring.size_approx() == 6);
+
+	std::vector<int> out(8);
+	CHECK(ring.pop(out.data(), out.size()) == 6);
+	for(size_t i=0; i<6; ++i) {
+		CHECK(out[i] == in[i]);
+	}
+}
+
+TEST_CASE("[jjspillring][clear] clear empties the spill file") {
+	test_file_t file;
+	jjspillring<int, 4> ring;
+	REQUIRE(ring.open(file.path.c_str(), 16 * sizeof(int)));
+	for(int i=0; i<8; ++i) {
+		ring.push(i);
+	}
+	ring.clear();
+	CHECK(ring.empty() == true);
+	CHECK(ring.size_approx() == 0);
+	CHECK(ring.push(42) == true);
+	CHECK(ring.spilled_approx() == 0);
+}
+
+TEST_CASE("[jjspillring][threads] concurrent producer and stalling consumer keep FIFO order") {
+	test_file_t file;
+	jjspillring<uint32_t, 16> ring;
+	REQUIRE(ring.open(file.path.c_str(), 1 << 16));
+
+	constexpr uint32_t count = 100000;
+	std::thread producer([&] {
+		uint32_t batch[7];
+		for(uint32_t i=0; i<count;) {
+			if(i % 3 == 0) {
+				uint32_t n = 0;
+				for(; n<7 && i+n<count; ++n) {
+					batch[n] = i + n;
+				}
+				i += static_cast<uint32_t>(ring.push(batch, n));
+			} else if(ring.push(i)) {
+				++i;
+			}
+		}
+	});
+
+	uint32_t expected = 0;
+	bool ordered = true;
+	uint32_t out[5];
+	while(expected < count) {
+		if(expected % 4096 == 0) {
+			// Stall, to let the producer overflow into the spill file
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+		}
+		if(expected % 2 == 0) {
+			const auto n = ring.pop(out, 5);
+			for(size_t i=0; i<n; ++i) {
+				ordered = ordered && out[i] == expected++;
+			}
+		} else if(ring.pop(out[0])) {
+			ordered = ordered && out[0] == expected++;
+		}
+	}
+	producer.join();
+	CHECK(ordered == true);
+	CHECK(ring.empty() == true);
+}
+
+TEST_SUITE_END();
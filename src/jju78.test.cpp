@@ -1,5 +1,6 @@
 #include "../ext/doctest.h"
 #include "jju78.hpp"
+#include <ios>
 
 TEST_SUITE_BEGIN("jju78");
 
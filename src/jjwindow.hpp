@@ -0,0 +1,209 @@
+#pragma once
+#include "jjring.hpp"
+#include <cstddef>
+
+/**
+ * @return The smallest power of 2 greater than or equal to `n`.
+ */
+constexpr size_t jjwindow_pow2(size_t n) {
+	size_t p = 1;
+	while(p < n) {
+		p *= 2;
+	}
+	return p;
+}
+
+/**
+ * A sliding window over the last `Size` samples, maintaining their sum, mean, variance, minimum and maximum in O(1) amortized time per sample.
+ *
+ * Samples are kept in a single-threaded `jjring`, and the minimum and maximum are tracked with monotonic queues of the samples that can still become extrema.
+ * @tparam T The sample type.
+ * @tparam Size The number of samples in the window. The storage is rounded up to a power of 2 above `Size`, so `2^k - 1` wastes no memory.
+ * @tparam Acc The type used to accumulate sums and sums of squares. With an integer type, sums of integer samples are exact, and the mean and variance are truncated.
+ * @note With floating-point accumulators, rounding errors of the running sums accumulate over time; call `clear()` and refill occasionally if that matters.
+ */
+template <typename T, size_t Size, typename Acc = double>
+class jjwindow {
+public:
+	static_assert(Size > 0, "Size must be greater than zero");
+	using value_type = T;
+	static constexpr size_t storage = jjwindow_pow2(Size + 1);
+public:
+	/**
+	 * Clear the window.
+	 */
+	void clear() noexcept {
+		ring.clear();
+		mins.clear();
+		maxs.clear();
+		count = 0;
+		sequence = 0;
+		total = 0;
+		total_sq = 0;
+	}
+	/**
+	 * @return The number of samples in the window, up to `Size`.
+	 */
+	size_t size() const noexcept {
+		return count;
+	}
+	/**
+	 * @return true if the window holds no sample.
+	 */
+	bool empty() const noexcept {
+		return count == 0;
+	}
+	/**
+	 * @return true if the window holds `Size` samples, so that each new sample evicts the oldest one.
+	 */
+	bool full() const noexcept {
+		return count == Size;
+	}
+	/**
+	 * @return The maximum number of samples in the window.
+	 */
+	constexpr size_t capacity() const noexcept {
+		return Size;
+	}
+
+	/**
+	 * Add a sample, evicting the oldest one if the window is full.
+	 */
+	void push(T x) noexcept {
+		if(count == Size) {
+			T old;
+			ring.pop(old);
+			total -= Acc(old);
+			total_sq -= Acc(old) * Acc(old);
+			--count;
+			// Extrema only expire when they are the evicted sample itself
+			const auto evicted = sequence - Size;
+			if(mins.front().sequence == evicted) {
+				mins.pop_front();
+			}
+			if(maxs.front().sequence == evicted) {
+				maxs.pop_front();
+			}
+		}
+		ring.push(x);
+		total += Acc(x);
+		total_sq += Acc(x) * Acc(x);
+		++count;
+		while(!mins.empty() && !(mins.back().value < x)) {
+			mins.pop_back();
+		}
+		mins.push_back({x, sequence});
+		while(!maxs.empty() && !(x < maxs.back().value)) {
+			maxs.pop_back();
+		}
+		maxs.push_back({x, sequence});
+		++sequence;
+	}
+	/**
+	 * Add a block of samples, in order.
+	 * @note When the block is larger than the window, only its last `Size` samples are processed.
+	 */
+	void push(const T* src, size_t n) noexcept {
+		if(n >= Size) {
+			clear();
+			src += n - Size;
+			n = Size;
+		}
+		for(size_t i=0; i<n; ++i) {
+			push(src[i]);
+		}
+	}
+
+	/**
+	 * @return The sum of the samples in the window.
+	 */
+	Acc sum() const noexcept {
+		return total;
+	}
+	/**
+	 * @return The mean of the samples in the window.
+	 * @warning The window must not be empty.
+	 */
+	Acc mean() const noexcept {
+		return total / Acc(count);
+	}
+	/**
+	 * @return The population variance of the samples in the window.
+	 * @warning The window must not be empty.
+	 */
+	Acc variance() const noexcept {
+		const Acc n = Acc(count);
+		const Acc v = (total_sq - total * total / n) / n;
+		return v < Acc(0)? Acc(0) : v;
+	}
+	/**
+	 * @return The smallest sample in the window.
+	 * @warning The window must not be empty.
+	 */
+	T min() const noexcept {
+		return mins.front().value;
+	}
+	/**
+	 * @return The largest sample in the window.
+	 * @warning The window must not be empty.
+	 */
+	T max() const noexcept {
+		return maxs.front().value;
+	}
+	/**
+	 * @return A pointer to the `i`-th oldest sample in the window, or nullptr if there are not more than `i` samples.
+	 */
+	const T* at(size_t i) const noexcept {
+		return ring.peek_at(i);
+	}
+private:
+	struct entry_t {
+		T value;
+		size_t sequence;
+	};
+
+	/**
+	 * A double-ended queue of at most `Size` entries, over the same power of 2 storage as the samples.
+	 */
+	class deque_t {
+	public:
+		void clear() noexcept {
+			head = tail = 0;
+		}
+		bool empty() const noexcept {
+			return head == tail;
+		}
+		const entry_t& front() const noexcept {
+			return items[head];
+		}
+		const entry_t& back() const noexcept {
+			return items[(tail - 1) & mask];
+		}
+		void push_back(const entry_t& e) noexcept {
+			items[tail] = e;
+			tail = (tail + 1) & mask;
+		}
+		void pop_back() noexcept {
+			tail = (tail - 1) & mask;
+		}
+		void pop_front() noexcept {
+			head = (head + 1) & mask;
+		}
+	private:
+		static constexpr size_t mask = storage - 1;
+		entry_t items[storage];
+		size_t head = 0;
+		size_t tail = 0;
+	};
+
+	jjring<T, storage, jjring_local> ring;
+	deque_t mins;
+	deque_t maxs;
+	size_t count = 0;
+	size_t sequence = 0;
+	Acc total = 0;
+	Acc total_sq = 0;
+};
+
+template <typename T, size_t Size, typename Acc>
+constexpr size_t jjwindow<T, Size, Acc>::storage;
@@ -0,0 +1,113 @@
+#include "../ext/doctest.h"
+#include "jjwindow.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <vector>
+
+TEST_SUITE_BEGIN("jjwindow");
+
+TEST_CASE("[jjwindow] storage is the power of 2 above the window size") {
+	CHECK(jjwindow<int, 1>::storage == 2);
+	CHECK(jjwindow<int, 63>::storage == 64);
+	CHECK(jjwindow<int, 64>::storage == 128);
+}
+
+TEST_CASE("[jjwindow] statistics of a partially filled window") {
+	jjwindow<int, 4, int64_t> w;
+	CHECK(w.empty() == true);
+	w.push(3);
+	w.push(-1);
+	w.push(4);
+	CHECK(w.size() == 3);
+	CHECK(w.full() == false);
+	CHECK(w.sum() == 6);
+	CHECK(w.mean() == 2);
+	CHECK(w.min() == -1);
+	CHECK(w.max() == 4);
+	CHECK(*w.at(0) == 3);
+	CHECK(w.at(3) == nullptr);
+}
+
+TEST_CASE("[jjwindow] eviction updates all statistics") {
+	jjwindow<double, 3> w;
+	const double in[] = {5, 1, 2, 8, 0, 0, 0};
+	w.push(in, 4); // {1, 2, 8}
+	CHECK(w.full() == true);
+	CHECK(w.sum() == doctest::Approx(11));
+	CHECK(w.min() == 1);
+	CHECK(w.max() == 8);
+	CHECK(w.variance() == doctest::Approx((1 + 4 + 64) / 3.0 - (11 / 3.0) * (11 / 3.0)));
+	w.push(in + 4, 3); // {0, 0, 0}
+	CHECK(w.sum() == 0);
+	CHECK(w.min() == 0);
+	CHECK(w.max() == 0);
+	CHECK(w.variance() == 0);
+}
+
+TEST_CASE("[jjwindow] equal values expire one at a time") {
+	jjwindow<int, 2> w;
+	w.push(7);
+	w.push(7);
+	w.push(9);
+	CHECK(w.min() == 7);
+	CHECK(w.max() == 9);
+	w.push(9);
+	CHECK(w.min() == 9);
+}
+
+TEST_CASE("[jjwindow] single-sample window") {
+	jjwindow<float, 1> w;
+	for(float x : {1.f, -2.f, 3.f}) {
+		w.push(x);
+		CHECK(w.size() == 1);
+		CHECK(w.min() == x);
+		CHECK(w.max() == x);
+		CHECK(w.mean() == doctest::Approx(x));
+		CHECK(w.variance() == doctest::Approx(0));
+	}
+}
+
+TEST_CASE("[jjwindow] matches a brute-force window on random samples") {
+	std::mt19937 rng(0x1234);
+	std::uniform_int_distribution<int> value(-1000, 1000);
+	std::uniform_int_distribution<size_t> block(1, 40);
+	jjwindow<int32_t, 31, int64_t> w;
+	std::deque<int32_t> ref;
+
+	for(int iter=0; iter<300; ++iter) {
+		std::vector<int32_t> in(block(rng));
+		for(auto& x : in) {
+			x = value(rng);
+		}
+		if(iter % 2) {
+			w.push(in.data(), in.size());
+		} else {
+			for(auto x : in) {
+				w.push(x);
+			}
+		}
+		for(auto x : in) {
+			ref.push_back(x);
+			if(ref.size() > 31) {
+				ref.pop_front();
+			}
+		}
+
+		int64_t sum = 0, sum_sq = 0;
+		for(auto x : ref) {
+			sum += x;
+			sum_sq += int64_t(x) * x;
+		}
+		const int64_t n = int64_t(ref.size());
+		REQUIRE(w.size() == ref.size());
+		CHECK(w.sum() == sum);
+		CHECK(w.variance() == (sum_sq - sum * sum / n) / n);
+		CHECK(w.min() == *std::min_element(ref.begin(), ref.end()));
+		CHECK(w.max() == *std::max_element(ref.begin(), ref.end()));
+		CHECK(*w.at(0) == ref.front());
+	}
+}
+
+TEST_SUITE_END();
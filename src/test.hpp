@@ -0,0 +1,26 @@
+#pragma once
+#include "../ext/doctest.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+
+/**
+ * A temporary file for tests, removed at the end of its scope.
+ */
+struct test_file_t {
+	std::string path;
+
+	test_file_t() {
+		char name[] = "/tmp/jjtest.XXXXXX";
+		const int fd = mkstemp(name);
+		REQUIRE(fd >= 0);
+		close(fd);
+		path = name;
+	}
+	~test_file_t() {
+		std::remove(path.c_str());
+	}
+	test_file_t(const test_file_t&) = delete;
+	test_file_t& operator=(const test_file_t&) = delete;
+};